@@ -0,0 +1,36 @@
+#pragma once
+
+// std::vector with cache line aligned storage, for the structure-of-arrays
+// entity fields that the update passes stream through.
+
+#include <stddef.h>
+#include <new>
+#include <vector>
+
+const size_t ENTITY_ALIGNMENT = 64;
+
+template <typename T>
+struct AlignedAllocator {
+    using value_type = T;
+
+    AlignedAllocator() = default;
+
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(ENTITY_ALIGNMENT)));
+    }
+
+    void deallocate(T* p, size_t) {
+        ::operator delete(p, std::align_val_t(ENTITY_ALIGNMENT));
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U>&) const {
+        return true;
+    }
+};
+
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
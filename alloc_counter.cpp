@@ -0,0 +1,117 @@
+#include "alloc_counter.h"
+
+#include <atomic>
+#include <new>
+#include <cstddef>
+#include <stdio.h>
+#include <stdlib.h>
+
+// A cache line per tag, threads allocating under different tags don't
+// contend
+struct alignas(64) TagCounters {
+    std::atomic<uint64_t> count{ 0 };
+    std::atomic<uint64_t> bytes{ 0 };
+};
+
+static TagCounters counters[ALLOC_TAG_COUNT];
+static std::atomic<bool> forbidden{ false };
+
+uint64_t globalAllocationCount() {
+    uint64_t count = 0;
+    for (TagCounters& c : counters) {
+        count += c.count.load(std::memory_order_relaxed);
+    }
+    return count;
+}
+
+AllocStats allocationStats(AllocTag tag) {
+    AllocStats stats;
+    stats.count = counters[tag].count.load(std::memory_order_relaxed);
+    stats.bytes = counters[tag].bytes.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void forbidAllocations(bool forbid) {
+    forbidden.store(forbid, std::memory_order_relaxed);
+}
+
+static void* countedAlloc(size_t size, size_t alignment) {
+    AllocTag tag = currentAllocTag;
+    counters[tag].count.fetch_add(1, std::memory_order_relaxed);
+    counters[tag].bytes.fetch_add(size, std::memory_order_relaxed);
+
+    if (forbidden.load(std::memory_order_relaxed)) {
+        // Formatted on the stack, stderr is unbuffered
+        forbidden.store(false, std::memory_order_relaxed);
+        char message[128];
+        snprintf(message, sizeof(message), "Heap allocation of %zu bytes (%s) after warm-up\n", size, allocTagName(tag));
+        fputs(message, stderr);
+        abort();
+    }
+
+    if (size == 0) {
+        size = 1;
+    }
+
+    void* p;
+    if (alignment <= alignof(std::max_align_t)) {
+        p = malloc(size);
+    }
+    else {
+        // aligned_alloc wants a multiple of the alignment
+        p = aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1));
+    }
+
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new(size_t size) {
+    return countedAlloc(size, alignof(std::max_align_t));
+}
+
+void* operator new[](size_t size) {
+    return countedAlloc(size, alignof(std::max_align_t));
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    return countedAlloc(size, (size_t)alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+    return countedAlloc(size, (size_t)alignment);
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t, std::align_val_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, size_t, std::align_val_t) noexcept {
+    free(p);
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+// Counts calls to the global operator new. Link alloc_counter.cpp into an
+// executable to replace the global allocation functions with counting
+// ones; the simulation library does not do this on its own.
+//
+// Allocations are counted under the tag of the thread that makes them,
+// set for a scope with AllocScope:
+//
+//     {
+//         AllocScope scope(ALLOC_RENDER);
+//         drawField(...);
+//     }
+//
+// Tags are header only, so code that is linked without alloc_counter.cpp
+// can still set them.
+
+#include <stdint.h>
+#include <stddef.h>
+
+enum AllocTag {
+    ALLOC_OTHER,
+    ALLOC_SIMULATION,
+    ALLOC_RENDER,
+    ALLOC_HUD,
+    ALLOC_IO,
+    ALLOC_TAG_COUNT,
+};
+
+inline const char* allocTagName(AllocTag tag) {
+    switch (tag) {
+    case ALLOC_OTHER: return "other";
+    case ALLOC_SIMULATION: return "simulation";
+    case ALLOC_RENDER: return "render";
+    case ALLOC_HUD: return "HUD";
+    case ALLOC_IO: return "I/O";
+    case ALLOC_TAG_COUNT: break;
+    }
+    return "?";
+}
+
+inline thread_local AllocTag currentAllocTag = ALLOC_OTHER;
+
+struct AllocScope {
+    AllocTag previous;
+
+    explicit AllocScope(AllocTag tag) : previous(currentAllocTag) {
+        currentAllocTag = tag;
+    }
+
+    ~AllocScope() {
+        currentAllocTag = previous;
+    }
+};
+
+struct AllocStats {
+    uint64_t count = 0;
+    // Requested, frees are not subtracted
+    uint64_t bytes = 0;
+};
+
+// Number of global heap allocations since start
+uint64_t globalAllocationCount();
+
+// Allocations since start made under tag
+AllocStats allocationStats(AllocTag tag);
+
+// While forbidden, any heap allocation prints its size and tag to stderr
+// and aborts. For checking that a warmed up loop doesn't allocate
+void forbidAllocations(bool forbidden);
@@ -0,0 +1,392 @@
+// Microbenchmarks of the simulation hot paths, printed as JSON.
+//
+// Usage: ./bench [--quick] [--filter name] [--min-time seconds]
+//
+//   --quick     smaller sweeps, for a fast check that everything runs
+//   --filter    only benchmarks whose name contains this
+//   --min-time  time each case runs for, 0.2 s by default
+//
+// Every case is one object in "results" with the benchmark name, its
+// parameters, the iterations run and nanoseconds per operation. What an
+// operation is depends on the benchmark, see "unit".
+
+#include <chrono>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "simulation.h"
+#include "trace.h"
+
+struct Param {
+    const char* name;
+    uint64_t value;
+};
+
+struct Bench {
+    const char* filter = NULL;
+    double minTime = 0.2;
+    bool first = true;
+
+    bool selected(const char* name) const {
+        return !filter || strstr(name, filter);
+    }
+};
+
+// Keeps results alive so the measured work isn't optimized away
+volatile uint64_t sink;
+
+// Calls run(iterations) with growing counts until it takes minTime, then
+// prints the case. run returns how many operations it did
+template <typename F>
+void measure(Bench& bench, const char* name, const char* unit, std::initializer_list<Param> params, F&& run) {
+    uint64_t iterations = 1;
+    uint64_t operations = 0;
+    double seconds = 0;
+
+    while (true) {
+        auto start = std::chrono::steady_clock::now();
+        operations = run(iterations);
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (seconds >= bench.minTime || iterations >= (1ULL << 40)) {
+            break;
+        }
+
+        // Aim a bit past minTime from what this round took
+        double scale = seconds > 0 ? 1.4 * bench.minTime / seconds : 100;
+        iterations = (uint64_t)(iterations * fmin(fmax(scale, 2), 100));
+    }
+
+    printf("%s\n    {\"name\": \"%s\", \"unit\": \"%s\", \"params\": {", bench.first ? "" : ",", name, unit);
+    bool firstParam = true;
+    for (const Param& p : params) {
+        printf("%s\"%s\": %llu", firstParam ? "" : ", ", p.name, (unsigned long long)p.value);
+        firstParam = false;
+    }
+    printf("}, \"iterations\": %llu, \"operations\": %llu, \"seconds\": %.6f, \"ns_per_op\": %.3f}",
+        (unsigned long long)iterations, (unsigned long long)operations, seconds,
+        operations > 0 ? seconds * 1e9 / operations : 0.0);
+    fflush(stdout);
+
+    bench.first = false;
+}
+
+// Star shaped like the library shapes, around the origin
+std::vector<Vector2> randomPolygon(Random& random, int n) {
+    std::vector<Vector2> polygon;
+
+    for (int i = 0; i < n; i++) {
+        float angle = 2 * PI * i / n;
+        float r = random.uniform(30, 60);
+        polygon.push_back(Vector2{ r * cosf(angle), r * sinf(angle) });
+    }
+
+    return polygon;
+}
+
+std::vector<Vector2> randomPoints(Random& random, size_t n, float extent) {
+    std::vector<Vector2> points;
+
+    for (size_t i = 0; i < n; i++) {
+        points.push_back(Vector2{ random.uniform(-extent, extent), random.uniform(-extent, extent) });
+    }
+
+    return points;
+}
+
+void benchCheckAsteroidCollision(Bench& bench, const std::vector<uint64_t>& vertexCounts) {
+    const char* name = "check_asteroid_collision";
+    if (!bench.selected(name)) {
+        return;
+    }
+
+    for (uint64_t n : vertexCounts) {
+        Random random(n);
+        std::vector<Vector2> polygon = randomPolygon(random, (int)n);
+        std::vector<Vector2> points = randomPoints(random, 1024, 70);
+
+        measure(bench, name, "point", { { "vertices", n } }, [&](uint64_t iterations) {
+            uint64_t inside = 0;
+            for (uint64_t it = 0; it < iterations; it++) {
+                for (Vector2 p : points) {
+                    inside += CheckAsteroidCollision(p, polygon);
+                }
+            }
+            sink = inside;
+            return iterations * points.size();
+        });
+    }
+}
+
+void benchCheckAsteroidCollisionBatch(Bench& bench, const std::vector<uint64_t>& vertexCounts) {
+    const char* name = "check_asteroid_collision_batch";
+    if (!bench.selected(name)) {
+        return;
+    }
+
+    for (uint64_t n : vertexCounts) {
+        Random random(n);
+        std::vector<Vector2> polygon = randomPolygon(random, (int)n);
+        std::vector<Vector2> points = randomPoints(random, 1024, 70);
+        std::vector<uint8_t> inside(points.size());
+        PolygonEdges edges;
+        edges.set(polygon.data(), polygon.size());
+
+        measure(bench, name, "point", { { "vertices", n }, { "simd", (uint64_t)bestSimdLevel() } }, [&](uint64_t iterations) {
+            for (uint64_t it = 0; it < iterations; it++) {
+                CheckAsteroidCollisionBatch(points.data(), points.size(), edges, inside.data());
+            }
+            sink = inside[0];
+            return iterations * points.size();
+        });
+    }
+}
+
+void benchCenterPoint(Bench& bench, const std::vector<uint64_t>& vertexCounts) {
+    const char* name = "center_point";
+    if (!bench.selected(name)) {
+        return;
+    }
+
+    for (uint64_t n : vertexCounts) {
+        Random random(n);
+        std::vector<Vector2> polygon = randomPolygon(random, (int)n);
+
+        measure(bench, name, "call", { { "vertices", n } }, [&](uint64_t iterations) {
+            float sum = 0;
+            for (uint64_t it = 0; it < iterations; it++) {
+                sum += centerPoint(polygon).x;
+            }
+            sink = (uint64_t)sum;
+            return iterations;
+        });
+    }
+}
+
+Asteroids randomAsteroids(uint64_t n) {
+    Random random(n);
+    Asteroids asteroids;
+
+    for (uint64_t i = 0; i < n; i++) {
+        asteroids.push_back(getRandAsteroid(random));
+    }
+
+    return asteroids;
+}
+
+void benchRotate(Bench& bench, const std::vector<uint64_t>& asteroidCounts) {
+    const char* name = "asteroids_rotate";
+    if (!bench.selected(name)) {
+        return;
+    }
+
+    for (uint64_t n : asteroidCounts) {
+        Asteroids asteroids = randomAsteroids(n);
+
+        // Angles plus the rotation matrices, as a detailed asteroid gets
+        measure(bench, name, "asteroid", { { "asteroids", n } }, [&](uint64_t iterations) {
+            for (uint64_t it = 0; it < iterations; it++) {
+                asteroids.rotate();
+                for (size_t i = 0; i < asteroids.size(); i++) {
+                    asteroids.refreshRotation(i);
+                }
+            }
+            sink = (uint64_t)asteroids.angle[0];
+            return iterations * n;
+        });
+    }
+}
+
+void benchMoveShots(Bench& bench, const std::vector<uint64_t>& shotCounts) {
+    const char* name = "move_shots";
+    if (!bench.selected(name)) {
+        return;
+    }
+
+    // moveShots drops shots that leave the field, on this one they can't
+    Config saved = config;
+    config.fieldWidth = 1000000000;
+    config.fieldHeight = 1000000000;
+    Vector2 middle = { config.fieldWidth / 2.0f, config.fieldHeight / 2.0f };
+
+    for (uint64_t n : shotCounts) {
+        Random random(n);
+        Shots shots;
+
+        for (uint64_t i = 0; i < n; i++) {
+            float angle = random.uniform(-PI, PI);
+            shots.push_back(Shot{ middle, Vector2{ cosf(angle), sinf(angle) } });
+        }
+
+        measure(bench, name, "shot", { { "shots", n } }, [&](uint64_t iterations) {
+            for (uint64_t it = 0; it < iterations; it++) {
+                moveShots(shots);
+            }
+            sink = (uint64_t)shots.x[0];
+            return iterations * n;
+        });
+    }
+
+    config = saved;
+}
+
+void benchGetRandAsteroid(Bench& bench, const std::vector<uint64_t>& fieldSizes) {
+    const char* name = "get_rand_asteroid";
+    if (!bench.selected(name)) {
+        return;
+    }
+
+    Config saved = config;
+
+    for (uint64_t size : fieldSizes) {
+        config.fieldWidth = (int)size;
+        config.fieldHeight = (int)size;
+        Random random(size);
+
+        measure(bench, name, "asteroid", { { "field", size } }, [&](uint64_t iterations) {
+            float sum = 0;
+            for (uint64_t it = 0; it < iterations; it++) {
+                sum += getRandAsteroid(random).pos.x;
+            }
+            sink = (uint64_t)sum;
+            return iterations;
+        });
+    }
+
+    config = saved;
+}
+
+// A whole tick with the field full: moves, the grid, every collision test
+// and the removal of what was hit. Shots are spread over the field first
+void benchWorldStep(Bench& bench, const std::vector<uint64_t>& asteroidCounts,
+    const std::vector<uint64_t>& shotCounts, const std::vector<uint64_t>& fieldSizes) {
+    const char* name = "world_step";
+    if (!bench.selected(name)) {
+        return;
+    }
+
+    Config saved = config;
+
+    for (uint64_t size : fieldSizes) {
+        for (uint64_t asteroidCount : asteroidCounts) {
+            for (uint64_t shotCount : shotCounts) {
+                config.fieldWidth = (int)size;
+                config.fieldHeight = (int)size;
+                config.maxAsteroids = asteroidCount;
+                config.maxShots = shotCount;
+
+                World world(size ^ asteroidCount ^ shotCount);
+                Random random(shotCount);
+
+                while (world.asteroids.size() < asteroidCount) {
+                    world.asteroids.push_back(getRandAsteroid(world.random));
+                }
+
+                auto refillShots = [&]() {
+                    while (world.shots.size() < shotCount) {
+                        float angle = random.uniform(-PI, PI);
+                        Vector2 pos = { random.uniform(0, size), random.uniform(0, size) };
+                        world.shots.push_back(Shot{ pos, Vector2{ cosf(angle), sinf(angle) } });
+                    }
+                };
+
+                Input input;
+
+                measure(bench, name, "tick",
+                    { { "field", size }, { "asteroids", asteroidCount }, { "shots", shotCount } },
+                    [&](uint64_t iterations) {
+                        for (uint64_t it = 0; it < iterations; it++) {
+                            // Kept full, outside of what step() does itself
+                            // this is a few pushes per tick
+                            refillShots();
+                            world.step(input);
+                        }
+                        sink = world.score;
+                        return iterations;
+                    });
+            }
+        }
+    }
+
+    config = saved;
+}
+
+// Recording one event into the ring, what a traced tick costs when its
+// span comes from timestamps the caller takes anyway
+void benchTraceEvent(Bench& bench) {
+    const char* name = "trace_event";
+    if (!bench.selected(name)) {
+        return;
+    }
+
+    startTracing(TRACE_TICKS);
+    TraceClock::time_point now = TraceClock::now();
+
+    measure(bench, name, "event", { { "events_per_thread", DEFAULT_TRACE_EVENTS } }, [&](uint64_t iterations) {
+        for (uint64_t it = 0; it < iterations; it++) {
+            traceEvent("tick", now, now);
+        }
+        return iterations;
+    });
+
+    stopTracing();
+}
+
+int main(int argc, char** argv) {
+    Bench bench;
+    bool quick = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            quick = true;
+        }
+        else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            bench.filter = argv[++i];
+        }
+        else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            bench.minTime = atof(argv[++i]);
+        }
+        else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    std::vector<uint64_t> vertexCounts = { 4, 8, 16, 32, 64, 128 };
+    std::vector<uint64_t> asteroidCounts = { 1000, 10000, 100000, 1000000 };
+    std::vector<uint64_t> shotCounts = { 100, 1000, 10000, 100000 };
+    std::vector<uint64_t> fieldSizes = { 2000, 20000, 200000, 1000000 };
+    std::vector<uint64_t> stepAsteroids = { 10, 1000, 100000 };
+    std::vector<uint64_t> stepShots = { 100, 10000 };
+    std::vector<uint64_t> stepFields = { 2000, 100000, 1000000 };
+
+    if (quick) {
+        vertexCounts = { 8, 64 };
+        asteroidCounts = { 1000, 100000 };
+        shotCounts = { 100, 10000 };
+        fieldSizes = { 2000, 1000000 };
+        stepAsteroids = { 10, 10000 };
+        stepShots = { 100 };
+        stepFields = { 2000, 100000 };
+    }
+
+    printf("{\n  \"simd\": \"%s\",\n  \"min_time\": %g,\n  \"results\": [", simdLevelName(bestSimdLevel()), bench.minTime);
+
+    benchCheckAsteroidCollision(bench, vertexCounts);
+    benchCheckAsteroidCollisionBatch(bench, vertexCounts);
+    benchCenterPoint(bench, vertexCounts);
+    benchRotate(bench, asteroidCounts);
+    benchMoveShots(bench, shotCounts);
+    benchGetRandAsteroid(bench, fieldSizes);
+    benchWorldStep(bench, stepAsteroids, stepShots, stepFields);
+    benchTraceEvent(bench);
+
+    printf("\n  ]\n}\n");
+
+    return 0;
+}
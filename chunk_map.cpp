@@ -0,0 +1,37 @@
+#include "chunk_map.h"
+
+#include <math.h>
+#include <algorithm>
+
+void ChunkMap::reset(float width, float height, float size) {
+    // Bigger chunks are still correct, only less selective
+    chunkSize = fmaxf(size, sqrtf(width * height / MAX_CHUNKS));
+    cols = (int)ceilf(width / chunkSize) + 1;
+    rows = (int)ceilf(height / chunkSize) + 1;
+    detailed.assign((size_t)cols * rows, 0);
+}
+
+void ChunkMap::clear() {
+    std::fill(detailed.begin(), detailed.end(), 0);
+}
+
+void ChunkMap::markAround(Vector2 p) {
+    int cx = chunkX(p.x);
+    int cy = chunkY(p.y);
+
+    markRect(
+        Vector2{ (cx - 1) * chunkSize, (cy - 1) * chunkSize },
+        Vector2{ (cx + 1) * chunkSize, (cy + 1) * chunkSize });
+}
+
+void ChunkMap::markRect(Vector2 min, Vector2 max) {
+    int x0 = chunkX(min.x);
+    int x1 = chunkX(max.x);
+    int y0 = chunkY(min.y);
+    int y1 = chunkY(max.y);
+
+    for (int y = y0; y <= y1; y++) {
+        size_t row = (size_t)y * cols;
+        std::fill(detailed.begin() + row + x0, detailed.begin() + row + x1 + 1, 1);
+    }
+}
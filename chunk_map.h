@@ -0,0 +1,50 @@
+#pragma once
+
+// Square chunks over the field with one detail flag each. Every tick the
+// chunks around the view and around each shot are marked, asteroids in the
+// other chunks only move. Entities are not stored per chunk, an asteroid
+// belongs to whatever chunk its position falls in, so crossing a border
+// needs no bookkeeping.
+
+#include "include/raymath.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+// Upper bound on chunks, so clearing the flags stays cheap on huge fields
+const size_t MAX_CHUNKS = 1 << 20;
+
+struct ChunkMap {
+    float chunkSize = 1;
+    int cols = 0;
+    int rows = 0;
+    std::vector<uint8_t> detailed;
+
+    // chunkSize must be at least the distance from an asteroid position to
+    // its farthest vertex for markAround() to cover every asteroid a point
+    // can touch. It is raised when the field would need more than
+    // MAX_CHUNKS chunks
+    void reset(float width, float height, float chunkSize);
+
+    void clear();
+
+    int chunkX(float x) const {
+        int cx = (int)(x / chunkSize);
+        return cx < 0 ? 0 : (cx >= cols ? cols - 1 : cx);
+    }
+
+    int chunkY(float y) const {
+        int cy = (int)(y / chunkSize);
+        return cy < 0 ? 0 : (cy >= rows ? rows - 1 : cy);
+    }
+
+    bool isDetailed(float x, float y) const {
+        return detailed[(size_t)chunkY(y) * cols + chunkX(x)];
+    }
+
+    // Marks the chunk of p and its eight neighbours
+    void markAround(Vector2 p);
+
+    // Marks every chunk overlapping the box
+    void markRect(Vector2 min, Vector2 max);
+};
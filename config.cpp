@@ -0,0 +1,187 @@
+#include "config.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+Config config;
+
+// Every option is a positive count that has to fit an int
+static bool validCount(long long n) {
+    return n > 0 && n <= INT_MAX;
+}
+
+bool validConfig(const Config& config) {
+    return validCount(config.fieldWidth) &&
+        validCount(config.fieldHeight) &&
+        validCount((long long)config.maxAsteroids) &&
+        validCount((long long)config.maxShots) &&
+        validCount(config.netGap) &&
+        validCount(config.chunkSize);
+}
+
+static bool setOption(const char* key, const char* value, Config& config) {
+    char* end;
+    long long n = strtoll(value, &end, 10);
+
+    if (end == value || *end != 0 || !validCount(n)) {
+        return false;
+    }
+
+    if (strcmp(key, "field-width") == 0) {
+        config.fieldWidth = (int)n;
+    }
+    else if (strcmp(key, "field-height") == 0) {
+        config.fieldHeight = (int)n;
+    }
+    else if (strcmp(key, "max-asteroids") == 0) {
+        config.maxAsteroids = (size_t)n;
+    }
+    else if (strcmp(key, "max-shots") == 0) {
+        config.maxShots = (size_t)n;
+    }
+    else if (strcmp(key, "net-gap") == 0) {
+        config.netGap = (int)n;
+    }
+    else if (strcmp(key, "chunk-size") == 0) {
+        config.chunkSize = (int)n;
+    }
+    else {
+        return false;
+    }
+
+    return true;
+}
+
+bool parseTickRate(const char* text, float& rate) {
+    char* end;
+    float value = strtof(text, &end);
+
+    // Zero, negative or infinite rates give an infinite, backwards or zero
+    // step
+    if (end == text || *end != 0 || !(value > 0) || !isfinite(value)) {
+        fprintf(stderr, "Bad tick rate %s, expected a positive number\n", text);
+        return false;
+    }
+
+    rate = value;
+    return true;
+}
+
+static char* trim(char* s) {
+    while (*s == ' ' || *s == '\t') {
+        s++;
+    }
+
+    char* end = s + strlen(s);
+    while (end > s && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\n' || end[-1] == '\r')) {
+        *--end = 0;
+    }
+
+    return s;
+}
+
+bool loadConfigFile(const char* path, Config& config) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Can't open config file %s\n", path);
+        return false;
+    }
+
+    bool ok = true;
+    char line[256];
+    int lineNumber = 0;
+
+    while (fgets(line, sizeof(line), file)) {
+        lineNumber++;
+
+        char* comment = strchr(line, '#');
+        if (comment) {
+            *comment = 0;
+        }
+
+        char* s = trim(line);
+        if (*s == 0) {
+            continue;
+        }
+
+        char* eq = strchr(s, '=');
+        if (!eq) {
+            fprintf(stderr, "%s:%d: expected key = value\n", path, lineNumber);
+            ok = false;
+            continue;
+        }
+
+        *eq = 0;
+        char* key = trim(s);
+        char* value = trim(eq + 1);
+
+        if (!setOption(key, value, config)) {
+            fprintf(stderr, "%s:%d: bad option %s = %s\n", path, lineNumber, key, value);
+            ok = false;
+        }
+    }
+
+    fclose(file);
+    return ok;
+}
+
+bool applyPreset(const char* name, Config& config) {
+    if (strcmp(name, "stress") == 0) {
+        config.fieldWidth = 1000000;
+        config.fieldHeight = 1000000;
+        config.maxAsteroids = 1000000;
+        config.maxShots = 10000;
+        return true;
+    }
+
+    if (strcmp(name, "default") == 0) {
+        config = Config();
+        return true;
+    }
+
+    return false;
+}
+
+ConfigArg parseConfigArg(int argc, char** argv, int& i, Config& config) {
+    const char* arg = argv[i];
+
+    if (strncmp(arg, "--", 2) != 0 || i + 1 >= argc) {
+        return CONFIG_ARG_NONE;
+    }
+
+    const char* value = argv[i + 1];
+    bool ok;
+
+    if (strcmp(arg, "--config") == 0) {
+        ok = loadConfigFile(value, config);
+    }
+    else if (strcmp(arg, "--preset") == 0) {
+        ok = applyPreset(value, config);
+        if (!ok) {
+            fprintf(stderr, "Unknown preset %s\n", value);
+        }
+    }
+    else {
+        Config probe = config;
+        if (!setOption(arg + 2, value, probe)) {
+            // Not ours, or a bad number for one of ours
+            if (setOption(arg + 2, "1", probe)) {
+                fprintf(stderr, "Bad value %s for %s\n", value, arg);
+                return CONFIG_ARG_ERROR;
+            }
+            return CONFIG_ARG_NONE;
+        }
+        config = probe;
+        ok = true;
+    }
+
+    if (!ok) {
+        return CONFIG_ARG_ERROR;
+    }
+
+    i++;
+    return CONFIG_ARG_OK;
+}
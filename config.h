@@ -0,0 +1,53 @@
+#pragma once
+
+// Game settings chosen at startup, from the command line or a config file.
+// The defaults are the original small map.
+
+#include <stddef.h>
+
+struct Config {
+    int fieldWidth = 2000;
+    int fieldHeight = 2000;
+    size_t maxAsteroids = 10;
+    size_t maxShots = 100;
+    // Background grid spacing, only used for drawing
+    int netGap = 100;
+    // Side of the level of detail chunks, see ChunkMap
+    int chunkSize = 2048;
+};
+
+extern Config config;
+
+// True if every setting is in the range the options accept, 1 to INT_MAX
+bool validConfig(const Config& config);
+
+// Reads a --tick-rate value, a positive number of simulation ticks per
+// game second. Prints why and returns false for anything else
+bool parseTickRate(const char* text, float& rate);
+
+// Reads "key = value" lines, '#' starts a comment. Keys are the long option
+// names without dashes, e.g. "field-width = 1000000". Returns false if the
+// file can't be read or has an unknown key or bad value
+bool loadConfigFile(const char* path, Config& config);
+
+// Named settings: "stress" is a 1,000,000 x 1,000,000 field with a million
+// asteroids. Returns false for unknown names
+bool applyPreset(const char* name, Config& config);
+
+enum ConfigArg {
+    // argv[i] is not a config option
+    CONFIG_ARG_NONE,
+    CONFIG_ARG_OK,
+    // A bad value, unknown preset or unreadable file, already reported on
+    // stderr
+    CONFIG_ARG_ERROR,
+};
+
+// Handles argv[i] if it is one of the options below, advancing i past its
+// value. Values are whole numbers from 1 to INT_MAX.
+//
+//   --config path        --preset name
+//   --field-width n      --field-height n
+//   --max-asteroids n    --max-shots n
+//   --net-gap n          --chunk-size n
+ConfigArg parseConfigArg(int argc, char** argv, int& i, Config& config);
@@ -0,0 +1,63 @@
+#include "frame_arena.h"
+
+#include <stdint.h>
+#include <new>
+
+const size_t ARENA_ALIGNMENT = 64;
+
+FrameArena::FrameArena(size_t size) {
+    capacity = size;
+    buffer = static_cast<std::byte*>(::operator new(capacity, std::align_val_t(ARENA_ALIGNMENT)));
+}
+
+FrameArena::~FrameArena() {
+    reset();
+    ::operator delete(buffer, std::align_val_t(ARENA_ALIGNMENT));
+}
+
+void FrameArena::reset() {
+    size_t needed = offset + overflowBytes;
+
+    while (overflow) {
+        Overflow* next = overflow->next;
+        ::operator delete(overflow, std::align_val_t(ARENA_ALIGNMENT));
+        overflow = next;
+    }
+
+    if (overflowBytes > 0) {
+        // Grow once so the same frame fits next time
+        ::operator delete(buffer, std::align_val_t(ARENA_ALIGNMENT));
+        capacity = needed * 2;
+        buffer = static_cast<std::byte*>(::operator new(capacity, std::align_val_t(ARENA_ALIGNMENT)));
+    }
+
+    offset = 0;
+    overflowBytes = 0;
+}
+
+void* FrameArena::do_allocate(size_t bytes, size_t alignment) {
+    size_t start = (offset + alignment - 1) & ~(alignment - 1);
+
+    if (start + bytes <= capacity) {
+        offset = start + bytes;
+        if (offset > highWater) {
+            highWater = offset;
+        }
+        return buffer + start;
+    }
+
+    // Header padded to the arena alignment keeps the payload aligned
+    size_t header = (sizeof(Overflow) + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+    if (alignment > ARENA_ALIGNMENT) {
+        throw std::bad_alloc();
+    }
+
+    void* block = ::operator new(header + bytes, std::align_val_t(ARENA_ALIGNMENT));
+    Overflow* node = static_cast<Overflow*>(block);
+    node->next = overflow;
+    node->size = bytes;
+    overflow = node;
+    overflowBytes += bytes + alignment;
+
+    return static_cast<std::byte*>(block) + header;
+}
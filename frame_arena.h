@@ -0,0 +1,44 @@
+#pragma once
+
+// Bump allocator for buffers that only live for one tick or frame. Hand it
+// to std::pmr containers and call reset() at the end of the tick; nothing
+// is freed individually.
+//
+// Requests that do not fit go to the heap and are freed on reset(), which
+// then grows the buffer so the next frame fits. After warm-up a frame
+// makes no global heap allocations.
+
+#include <stddef.h>
+#include <memory_resource>
+
+struct FrameArena : std::pmr::memory_resource {
+    std::byte* buffer = nullptr;
+    size_t capacity = 0;
+    size_t offset = 0;
+    // Largest offset reached since construction
+    size_t highWater = 0;
+
+    // Heap blocks for requests that did not fit, as a linked list
+    struct Overflow {
+        Overflow* next;
+        size_t size;
+    };
+    Overflow* overflow = nullptr;
+    size_t overflowBytes = 0;
+
+    explicit FrameArena(size_t capacity = 64 * 1024);
+    ~FrameArena();
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    void reset();
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+
+    void do_deallocate(void*, size_t, size_t) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
@@ -0,0 +1,387 @@
+// Runs the simulation without a window and without a frame cap.
+//
+// Usage: ./headless [options] [ticks] [seed]
+//        ./headless --check-pip [shapes] [seed]
+//
+//   --verify     run a brute-force collision world in lockstep and stop at
+//                the first tick where the two disagree
+//   --tick-rate  simulation ticks per game second, 60 by default
+//   --threads    worker threads for the asteroid pass besides the main one
+//   --pin        pin the main thread and the workers to one CPU each
+//   --record f   save the scripted input of the run as a recording
+//   --replay f   play a recording from the game or --record instead of the
+//                scripted input; its seed, tick rate and settings are used
+//   --trace f    write the last ticks as a Chrome trace-event JSON file,
+//                for Perfetto
+//   --trace-phases  with --trace, also trace the phases of each tick and the
+//                asteroid chunks of each thread. Adds a few tenths of a
+//                microsecond to every tick
+//   --histogram f  write the histogram of tick times as CSV, see histogram.h
+//   --fail-on-alloc  abort at the first heap allocation after warm-up
+//   --perf       count cycles, instructions, cache and branch misses of each
+//                simulation phase on the main thread, where Linux allows it
+//   --check-pip  compare CheckAsteroidCollisionBatch at every SIMD level the
+//                CPU has with the scalar CheckAsteroidCollision on random shapes
+//
+// Field size and entity limits take the options of parseConfigArg, for
+// example "./headless --preset stress 600" for a million asteroids on a
+// 1,000,000 x 1,000,000 field.
+//
+// The last line is the hash of the final world, equal between runs of the
+// same recording.
+
+#include <chrono>
+#include <math.h>
+#include <iostream>
+#include <optional>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "simulation.h"
+#include "recording.h"
+#include "alloc_counter.h"
+#include "trace.h"
+#include "histogram.h"
+#include "perf_counters.h"
+
+// Random polygons: star shaped ones like the library and arbitrary,
+// possibly self-intersecting ones. Query points are spread over the
+// bounding box and also placed on vertices and at vertex heights, where
+// the crossing test is most sensitive to rounding.
+int checkPointInPolygon(uint64_t shapes, uint64_t seed) {
+    Random random(seed);
+
+    std::vector<Vector2> polygon;
+    std::vector<Vector2> points;
+    std::vector<uint8_t> inside;
+    PolygonEdges edges;
+
+    uint64_t tested = 0;
+    uint64_t hits = 0;
+
+    for (uint64_t s = 0; s < shapes; s++) {
+        int n = random.value(3, 40);
+        Vector2 offset = { random.uniform(-5000, 5000), random.uniform(-5000, 5000) };
+
+        polygon.clear();
+        if (s % 2 == 0) {
+            for (int i = 0; i < n; i++) {
+                float angle = 2 * PI * i / n;
+                float r = random.uniform(10, 150);
+                polygon.push_back(Vector2Add(offset, Vector2{ r * cosf(angle), r * sinf(angle) }));
+            }
+        }
+        else {
+            for (int i = 0; i < n; i++) {
+                polygon.push_back(Vector2Add(offset, Vector2{ random.uniform(-150, 150), random.uniform(-150, 150) }));
+            }
+        }
+
+        points.clear();
+        for (int i = 0; i < 61; i++) {
+            points.push_back(Vector2Add(offset, Vector2{ random.uniform(-160, 160), random.uniform(-160, 160) }));
+        }
+        for (Vector2 v : polygon) {
+            points.push_back(v);
+            points.push_back(Vector2{ offset.x + random.uniform(-160, 160), v.y });
+        }
+
+        edges.set(polygon.data(), polygon.size());
+        inside.resize(points.size());
+
+        for (int level = 0; level <= (int)bestSimdLevel(); level++) {
+            CheckAsteroidCollisionBatch(points.data(), points.size(), edges, inside.data(), (SimdLevel)level);
+
+            for (size_t i = 0; i < points.size(); i++) {
+                bool expected = CheckAsteroidCollision(points[i], polygon);
+                if (expected != (bool)inside[i]) {
+                    std::cerr << "Mismatch at shape " << s << " point " << i
+                        << " level " << simdLevelName((SimdLevel)level) << std::endl;
+                    return 1;
+                }
+                tested++;
+                hits += expected;
+            }
+        }
+    }
+
+    std::cout << "simd " << simdLevelName(bestSimdLevel()) << std::endl;
+    std::cout << "tests " << tested << std::endl;
+    std::cout << "inside " << hits << std::endl;
+
+    return 0;
+}
+
+double perThousand(double count, double of) {
+    return of > 0 ? 1000.0 * count / of : 0;
+}
+
+// Per tick counts of each simulation phase, misses per thousand
+// instructions
+void printCounters(const FrameTimings& timings, const PerfCounters& perf) {
+    uint64_t ticks = timings.frames > 0 ? timings.frames : 1;
+
+    for (int p = PHASE_SHIP; p <= PHASE_REMOVAL; p++) {
+        const CounterValues& c = timings.counters[p];
+
+        std::cout << "perf " << phaseName((Phase)p);
+
+        // The group was never scheduled during this phase
+        if (!c.available()) {
+            std::cout << " n/a" << std::endl;
+            continue;
+        }
+
+        for (int k = 0; k < COUNTER_COUNT; k++) {
+            std::cout << " " << counterName((Counter)k) << " ";
+            if (perf.has((Counter)k)) {
+                std::cout << (uint64_t)(c[(Counter)k] / (double)ticks);
+            }
+            else {
+                std::cout << "n/a";
+            }
+        }
+
+        double ipc = c[COUNTER_CYCLES] > 0 ? c[COUNTER_INSTRUCTIONS] / c[COUNTER_CYCLES] : 0;
+        std::cout << " ipc " << ipc
+            << " l1d-mpki " << perThousand(c[COUNTER_L1D_MISSES], c[COUNTER_INSTRUCTIONS])
+            << " llc-mpki " << perThousand(c[COUNTER_LLC_MISSES], c[COUNTER_INSTRUCTIONS])
+            << " branch-mpki " << perThousand(c[COUNTER_BRANCH_MISSES], c[COUNTER_INSTRUCTIONS]) << std::endl;
+    }
+}
+
+// Positions and angles too, the level of detail must not change them
+bool sameState(World& a, World& b) {
+    return a.score == b.score &&
+        a.shots.size() == b.shots.size() &&
+        a.asteroids.size() == b.asteroids.size() &&
+        a.asteroids.x == b.asteroids.x &&
+        a.asteroids.y == b.asteroids.y &&
+        a.asteroids.angle == b.asteroids.angle;
+}
+
+int main(int argc, char** argv) {
+    uint64_t ticks = 1000000;
+    uint64_t seed = 1;
+    bool verify = false;
+    bool checkPip = false;
+    float tickRate = BASE_TICK_RATE;
+    unsigned threads = 0;
+    bool pin = false;
+    const char* recordPath = NULL;
+    const char* replayPath = NULL;
+    const char* tracePath = NULL;
+    bool tracePhases = false;
+    const char* histogramPath = NULL;
+    bool countPerf = false;
+    bool failOnAlloc = false;
+
+    int positional = 0;
+    for (int i = 1; i < argc; i++) {
+        ConfigArg configArg = parseConfigArg(argc, argv, i, config);
+        if (configArg == CONFIG_ARG_ERROR) {
+            return 1;
+        }
+        else if (configArg == CONFIG_ARG_OK) {
+            continue;
+        }
+        else if (strcmp(argv[i], "--verify") == 0) {
+            verify = true;
+        }
+        else if (strcmp(argv[i], "--check-pip") == 0) {
+            checkPip = true;
+        }
+        else if (strcmp(argv[i], "--tick-rate") == 0 && i + 1 < argc) {
+            if (!parseTickRate(argv[++i], tickRate)) {
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            if (!parseWorkerCount(argv[++i], threads)) {
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--pin") == 0) {
+            pin = true;
+        }
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            tracePath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--trace-phases") == 0) {
+            tracePhases = true;
+        }
+        else if (strcmp(argv[i], "--histogram") == 0 && i + 1 < argc) {
+            histogramPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--perf") == 0) {
+            countPerf = true;
+        }
+        else if (strcmp(argv[i], "--fail-on-alloc") == 0) {
+            failOnAlloc = true;
+        }
+        else if (positional == 0) {
+            ticks = strtoull(argv[i], NULL, 10);
+            positional++;
+        }
+        else {
+            seed = strtoull(argv[i], NULL, 10);
+        }
+    }
+
+    if (checkPip) {
+        return checkPointInPolygon(ticks, seed);
+    }
+
+    Recording replay;
+    if (replayPath) {
+        if (!loadRecording(replayPath, replay)) {
+            return 1;
+        }
+
+        applyRecordingConfig(replay, config);
+        seed = replay.seed;
+        tickRate = replay.tickRate;
+        ticks = replay.inputs.size();
+    }
+
+    Recording recording = beginRecording(seed, tickRate, config);
+    if (recordPath) {
+        recording.inputs.reserve(ticks);
+    }
+
+    JobSystem jobs(threads, pin);
+
+    World world(seed, tickRate);
+    if (threads > 0) {
+        world.jobs = &jobs;
+    }
+
+    // Each tick is a frame of the timings
+    PerfCounters perf;
+    FrameTimings timings;
+    if (countPerf) {
+        if (perf.open()) {
+            timings.enabled = true;
+            timings.perf = &perf;
+            world.timings = &timings;
+        }
+        else {
+            std::cerr << "Perf counters unavailable: " << perf.error << std::endl;
+        }
+    }
+
+    // Only built for --verify, it doubles memory and setup time
+    std::optional<World> reference;
+    if (verify) {
+        reference.emplace(seed, tickRate);
+        reference->bruteForceCollisions = true;
+    }
+
+    if (tracePath) {
+        startTracing(tracePhases ? TRACE_PHASES : TRACE_TICKS, threads);
+    }
+
+    // Containers reach their steady capacity within the first ticks
+    uint64_t warmup = ticks / 10;
+    uint64_t allocationsAtWarmup = 0;
+
+    // Time of each tick, from one tick's start to the next so a tick costs
+    // a single clock read
+    Histogram tickTimes("tick");
+
+    auto start = std::chrono::steady_clock::now();
+    auto warm = start;
+    auto tickStart = start;
+
+    for (uint64_t i = 0; i < ticks; i++) {
+        if (i == warmup) {
+            allocationsAtWarmup = globalAllocationCount();
+            warm = std::chrono::steady_clock::now();
+            forbidAllocations(failOnAlloc);
+        }
+
+        Input input = replayPath ? Input::fromBits(replay.inputs[i]) : Input::scripted(world.tick);
+        {
+            AllocScope scope(ALLOC_SIMULATION);
+            world.step(input);
+        }
+
+        if (world.timings) {
+            timings.endFrame();
+        }
+
+        if (recordPath) {
+            AllocScope scope(ALLOC_IO);
+            recording.inputs.push_back(input.bits());
+        }
+
+        if (verify) {
+            AllocScope scope(ALLOC_SIMULATION);
+            reference->step(input);
+
+            if (!sameState(world, *reference)) {
+                std::cerr << "Mismatch with brute-force collisions at tick " << world.tick << std::endl;
+                return 1;
+            }
+        }
+
+        auto tickEnd = std::chrono::steady_clock::now();
+        tickTimes.record(std::chrono::duration_cast<std::chrono::nanoseconds>(tickEnd - tickStart).count());
+        // The same span as the histogram, so a traced tick takes no
+        // extra clock reads
+        if (tracePath) {
+            traceEvent("tick", tickStart, tickEnd);
+        }
+        tickStart = tickEnd;
+    }
+
+    forbidAllocations(false);
+
+    auto finish = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(finish - start).count();
+    // Once the field has filled up
+    double sustainedSeconds = std::chrono::duration<double>(finish - warm).count();
+
+    std::cout << "field " << config.fieldWidth << "x" << config.fieldHeight << std::endl;
+    std::cout << "ticks " << ticks << std::endl;
+    std::cout << "seconds " << seconds << std::endl;
+    std::cout << "ticks/s " << (seconds > 0 ? ticks / seconds : 0) << std::endl;
+    std::cout << "sustained ticks/s " << (sustainedSeconds > 0 ? (ticks - warmup) / sustainedSeconds : 0) << std::endl;
+    std::cout << "score " << world.score << std::endl;
+    std::cout << "shots " << world.shots.size() << std::endl;
+    std::cout << "asteroids " << world.asteroids.size() << std::endl;
+    std::cout << "detailed asteroids " << world.detailedAsteroids << std::endl;
+    std::cout << "heap allocations after warm-up " << globalAllocationCount() - allocationsAtWarmup << std::endl;
+    printPercentiles(tickTimes, "us");
+
+    if (world.timings) {
+        printCounters(timings, perf);
+    }
+
+    if (histogramPath && !writeHistograms(histogramPath, { &tickTimes })) {
+        return 1;
+    }
+
+    if (recordPath && !saveRecording(recordPath, recording)) {
+        return 1;
+    }
+
+    if (tracePath) {
+        stopTracing();
+        std::cout << "trace events " << traceEventCount() << " (" << traceEventsDropped() << " overwritten)" << std::endl;
+        if (!writeTrace(tracePath)) {
+            return 1;
+        }
+    }
+
+    std::cout << "hash " << std::hex << world.hash() << std::dec << std::endl;
+
+    return 0;
+}
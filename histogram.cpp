@@ -0,0 +1,92 @@
+#include "histogram.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+uint64_t Histogram::bucketLow(size_t bucket) {
+    if (bucket < (1u << HISTOGRAM_SUB_BITS)) {
+        return bucket;
+    }
+    int shift = (int)(bucket >> (HISTOGRAM_SUB_BITS - 1)) - 1;
+    uint64_t mantissa = bucket - ((size_t)shift << (HISTOGRAM_SUB_BITS - 1));
+    return mantissa << shift;
+}
+
+uint64_t Histogram::bucketHigh(size_t bucket) {
+    if (bucket < (1u << HISTOGRAM_SUB_BITS)) {
+        return bucket;
+    }
+    int shift = (int)(bucket >> (HISTOGRAM_SUB_BITS - 1)) - 1;
+    return bucketLow(bucket) + ((uint64_t)1 << shift) - 1;
+}
+
+uint64_t Histogram::percentile(double p) const {
+    if (count == 0) {
+        return 0;
+    }
+    if (p >= 100) {
+        return max;
+    }
+
+    // Rank of the sample, 1 based
+    uint64_t rank = (uint64_t)ceil(p / 100 * (double)count);
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    for (size_t b = 0; b < HISTOGRAM_BUCKETS; b++) {
+        seen += counts[b];
+        if (seen >= rank) {
+            uint64_t high = bucketHigh(b);
+            return high < max ? high : max;
+        }
+    }
+
+    return max;
+}
+
+void printPercentiles(const Histogram& histogram, const char* unit) {
+    double scale = strcmp(unit, "ms") == 0 ? 1e6 : 1e3;
+    double mean = histogram.count > 0 ? histogram.sum / (double)histogram.count : 0;
+
+    printf("%s (%s) n %llu mean %.3f p50 %.3f p90 %.3f p99 %.3f p99.9 %.3f max %.3f\n",
+        histogram.name, unit, (unsigned long long)histogram.count, mean / scale,
+        histogram.percentile(50) / scale,
+        histogram.percentile(90) / scale,
+        histogram.percentile(99) / scale,
+        histogram.percentile(99.9) / scale,
+        histogram.percentile(100) / scale);
+}
+
+bool writeHistograms(const char* path, std::initializer_list<const Histogram*> histograms) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Can't write histogram %s\n", path);
+        return false;
+    }
+
+    fprintf(file, "histogram,low_ns,high_ns,count,percentile\n");
+
+    for (const Histogram* h : histograms) {
+        uint64_t seen = 0;
+        for (size_t b = 0; b < HISTOGRAM_BUCKETS; b++) {
+            if (h->counts[b] == 0) {
+                continue;
+            }
+            seen += h->counts[b];
+            fprintf(file, "%s,%llu,%llu,%llu,%.4f\n", h->name,
+                (unsigned long long)Histogram::bucketLow(b), (unsigned long long)Histogram::bucketHigh(b),
+                (unsigned long long)h->counts[b], 100.0 * (double)seen / (double)h->count);
+        }
+    }
+
+    bool ok = !ferror(file);
+    ok = fclose(file) == 0 && ok;
+    if (!ok) {
+        fprintf(stderr, "Failed writing histogram %s\n", path);
+    }
+
+    return ok;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+// High dynamic range histogram of durations in nanoseconds, for frame and
+// tick times. Buckets are linear within each power of two, 64 to 128 of
+// them, so any value from 1 ns to centuries is kept within 1% and record()
+// is a few instructions with no allocation.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <initializer_list>
+
+// Linear buckets per power of two are 2^(HISTOGRAM_SUB_BITS - 1)
+const int HISTOGRAM_SUB_BITS = 7;
+const size_t HISTOGRAM_BUCKETS = (64 - HISTOGRAM_SUB_BITS + 2) << (HISTOGRAM_SUB_BITS - 1);
+
+struct Histogram {
+    const char* name;
+
+    uint64_t counts[HISTOGRAM_BUCKETS] = {};
+    uint64_t count = 0;
+    uint64_t min = UINT64_MAX;
+    uint64_t max = 0;
+    // Sum of the values, for the mean
+    double sum = 0;
+
+    explicit Histogram(const char* name) : name(name) {}
+
+    static size_t bucketOf(uint64_t ns) {
+        if (ns < (1u << HISTOGRAM_SUB_BITS)) {
+            return (size_t)ns;
+        }
+        int shift = (63 - __builtin_clzll(ns)) - (HISTOGRAM_SUB_BITS - 1);
+        return ((size_t)shift << (HISTOGRAM_SUB_BITS - 1)) + (size_t)(ns >> shift);
+    }
+
+    // Smallest and largest value of a bucket
+    static uint64_t bucketLow(size_t bucket);
+    static uint64_t bucketHigh(size_t bucket);
+
+    void record(uint64_t ns) {
+        counts[bucketOf(ns)]++;
+        count++;
+        min = ns < min ? ns : min;
+        max = ns > max ? ns : max;
+        sum += (double)ns;
+    }
+
+    // Largest value of the bucket holding the p-th percentile, 0 to 100,
+    // and max for 100
+    uint64_t percentile(double p) const;
+};
+
+// One line: the name, count, mean and p50/p90/p99/p99.9/max, in unit
+// ("ms" or "us")
+void printPercentiles(const Histogram& histogram, const char* unit);
+
+// Every non-empty bucket of each histogram as CSV rows
+//
+//     histogram,low_ns,high_ns,count,percentile
+//
+// for diffing or plotting runs against each other. Returns false with a
+// message on stderr if the file can't be written
+bool writeHistograms(const char* path, std::initializer_list<const Histogram*> histograms);
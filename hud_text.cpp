@@ -0,0 +1,101 @@
+#include "hud_text.h"
+
+#include "include/rlgl.h"
+
+#include <string.h>
+
+void beginHud(Hud& hud) {
+    hud.used = 0;
+    hud.relayouts = 0;
+}
+
+// Same placement as DrawTextEx, for single line ASCII text
+static void layout(const Hud& hud, HudLine& line) {
+    const Font& font = hud.font;
+    float scale = hud.fontSize / font.baseSize;
+    float padding = (float)font.glyphPadding;
+    float offsetX = 0;
+
+    line.quads.clear();
+
+    for (const char* c = line.text; *c; c++) {
+        int index = GetGlyphIndex(font, (unsigned char)*c);
+        Rectangle rec = font.recs[index];
+        GlyphInfo& glyph = font.glyphs[index];
+
+        if (*c != ' ' && *c != '\t') {
+            GlyphQuad quad;
+            quad.dest = Rectangle{
+                line.pos.x + offsetX + glyph.offsetX * scale - padding * scale,
+                line.pos.y + glyph.offsetY * scale - padding * scale,
+                (rec.width + 2 * padding) * scale,
+                (rec.height + 2 * padding) * scale,
+            };
+            quad.u0 = (rec.x - padding) / font.texture.width;
+            quad.v0 = (rec.y - padding) / font.texture.height;
+            quad.u1 = (rec.x + rec.width + padding) / font.texture.width;
+            quad.v1 = (rec.y + rec.height + padding) / font.texture.height;
+            line.quads.push_back(quad);
+        }
+
+        float advance = glyph.advanceX == 0 ? rec.width : (float)glyph.advanceX;
+        offsetX += advance * scale + hud.spacing;
+    }
+}
+
+void setHudLine(Hud& hud, Vector2 pos, const char* text, size_t length) {
+    if (hud.used == hud.lines.size()) {
+        // Room for the longest text, so a line getting longer doesn't
+        // allocate
+        hud.lines.emplace_back();
+        hud.lines.back().quads.reserve(HUD_LINE_SIZE);
+    }
+
+    HudLine& line = hud.lines[hud.used++];
+
+    bool same = line.pos.x == pos.x && line.pos.y == pos.y && strcmp(line.text, text) == 0;
+    if (same) {
+        return;
+    }
+
+    memcpy(line.text, text, length + 1);
+    line.pos = pos;
+    layout(hud, line);
+    hud.relayouts++;
+}
+
+void drawHud(Hud& hud) {
+    size_t quads = 0;
+    for (size_t i = 0; i < hud.used; i++) {
+        quads += hud.lines[i].quads.size();
+    }
+
+    rlCheckRenderBatchLimit(4 * (int)quads);
+
+    rlSetTexture(hud.font.texture.id);
+    rlBegin(RL_QUADS);
+    rlColor4ub(hud.color.r, hud.color.g, hud.color.b, hud.color.a);
+    rlNormal3f(0, 0, 1);
+
+    for (size_t i = 0; i < hud.used; i++) {
+        for (const GlyphQuad& q : hud.lines[i].quads) {
+            float x0 = q.dest.x;
+            float y0 = q.dest.y;
+            float x1 = q.dest.x + q.dest.width;
+            float y1 = q.dest.y + q.dest.height;
+
+            // Counter-clockwise, like DrawTexturePro
+            rlTexCoord2f(q.u0, q.v0);
+            rlVertex2f(x0, y0);
+            rlTexCoord2f(q.u0, q.v1);
+            rlVertex2f(x0, y1);
+            rlTexCoord2f(q.u1, q.v1);
+            rlVertex2f(x1, y1);
+            rlTexCoord2f(q.u1, q.v0);
+            rlVertex2f(x1, y0);
+        }
+    }
+
+    rlEnd();
+    rlSetTexture(0);
+}
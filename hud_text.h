@@ -0,0 +1,66 @@
+#pragma once
+
+// HUD text that is formatted into fixed buffers and laid out only when a
+// line changes. The glyph quads of each line are kept, and every line of
+// the HUD goes out with the font texture as one run of quads.
+//
+// Lines are identified by the order they are added in each frame:
+//
+//     beginHud(hud);
+//     hudLine(hud, pos, "Score {:d}", score);
+//     ...
+//     drawHud(hud);
+
+#include "include/raylib.h"
+#include <stddef.h>
+#include <format>
+#include <vector>
+
+// Longer text is cut off
+const size_t HUD_LINE_SIZE = 128;
+
+struct GlyphQuad {
+    Rectangle dest;
+    // Texture coordinates, normalized
+    float u0;
+    float v0;
+    float u1;
+    float v1;
+};
+
+struct HudLine {
+    char text[HUD_LINE_SIZE] = {};
+    Vector2 pos = {};
+    std::vector<GlyphQuad> quads;
+};
+
+struct Hud {
+    Font font = {};
+    float fontSize = 0;
+    float spacing = 2;
+    Color color = LIGHTGRAY;
+
+    std::vector<HudLine> lines;
+    // Lines added this frame
+    size_t used = 0;
+    // Lines laid out again this frame
+    size_t relayouts = 0;
+};
+
+void beginHud(Hud& hud);
+
+// Sets the next line, laying it out again only if the text or the position
+// differ from the last frame
+void setHudLine(Hud& hud, Vector2 pos, const char* text, size_t length);
+
+template <typename... Args>
+void hudLine(Hud& hud, Vector2 pos, std::format_string<Args...> fmt, Args&&... args) {
+    char text[HUD_LINE_SIZE];
+    auto result = std::format_to_n(text, HUD_LINE_SIZE - 1, fmt, std::forward<Args>(args)...);
+    size_t length = result.out - text;
+    text[length] = 0;
+    setHudLine(hud, pos, text, length);
+}
+
+// Draws the lines of this frame
+void drawHud(Hud& hud);
@@ -0,0 +1,177 @@
+#include "job_system.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Binds the calling thread to one CPU, a no-op where unsupported
+static void pinCurrentThread(unsigned cpu) {
+#if defined(__linux__)
+    unsigned cpus = std::thread::hardware_concurrency();
+    if (cpus == 0) {
+        return;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu % cpus, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)cpu;
+#endif
+}
+
+bool parseWorkerCount(const char* text, unsigned& workers) {
+    char* end;
+    long n = strtol(text, &end, 10);
+
+    if (end == text || *end != 0 || n < 0 || n > (long)MAX_WORKERS) {
+        fprintf(stderr, "Bad thread count %s, expected 0 to %u\n", text, MAX_WORKERS);
+        return false;
+    }
+
+    workers = (unsigned)n;
+    return true;
+}
+
+JobSystem::JobSystem(unsigned workers, bool pinCores) {
+#if defined(__EMSCRIPTEN__)
+    // No threads in the web build, the caller runs everything
+    workers = 0;
+#endif
+    if (workers > MAX_WORKERS) {
+        workers = MAX_WORKERS;
+    }
+
+    participants = workers + 1;
+    queues = std::make_unique<Queue[]>(participants);
+
+    if (pinCores) {
+        pinCurrentThread(0);
+    }
+
+    for (unsigned w = 1; w <= workers; w++) {
+        threads.emplace_back([this, w, pinCores] {
+            if (pinCores) {
+                pinCurrentThread(w);
+            }
+            workerLoop(w);
+        });
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> guard(wakeLock);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (std::thread& t : threads) {
+        t.join();
+    }
+}
+
+void JobSystem::run(size_t n, size_t chunk, void (*fn)(void*, size_t, size_t, unsigned), void* ctx) {
+    if (n == 0) {
+        return;
+    }
+
+    size_t chunks = (n + chunk - 1) / chunk;
+
+    // Not worth waking anyone
+    if (threads.empty() || chunks == 1) {
+        fn(ctx, 0, n, 0);
+        return;
+    }
+
+    job = fn;
+    context = ctx;
+    count = n;
+    chunkSize = chunk;
+    chunksLeft.store(chunks, std::memory_order_relaxed);
+
+    // Contiguous runs of chunks, one per participant
+    for (unsigned w = 0; w < participants; w++) {
+        std::lock_guard<std::mutex> guard(queues[w].lock);
+        queues[w].begin = chunks * w / participants;
+        queues[w].end = chunks * (w + 1) / participants;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(wakeLock);
+        generation++;
+        running = (unsigned)threads.size();
+    }
+    wake.notify_all();
+
+    drain(0);
+
+    // Workers may still be finishing a stolen chunk
+    std::unique_lock<std::mutex> guard(wakeLock);
+    finished.wait(guard, [&] { return running == 0; });
+}
+
+void JobSystem::workerLoop(unsigned worker) {
+    uint64_t seen = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> guard(wakeLock);
+            wake.wait(guard, [&] { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+        }
+
+        drain(worker);
+
+        {
+            std::lock_guard<std::mutex> guard(wakeLock);
+            running--;
+        }
+        finished.notify_one();
+    }
+}
+
+void JobSystem::drain(unsigned worker) {
+    size_t chunk;
+
+    while (chunksLeft.load(std::memory_order_acquire) > 0 && takeChunk(worker, chunk)) {
+        size_t begin = chunk * chunkSize;
+        size_t end = begin + chunkSize < count ? begin + chunkSize : count;
+
+        job(context, begin, end, worker);
+
+        chunksLeft.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+bool JobSystem::takeChunk(unsigned worker, size_t& chunk) {
+    // Own run first, from the front
+    {
+        Queue& own = queues[worker];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (own.begin < own.end) {
+            chunk = own.begin++;
+            return true;
+        }
+    }
+
+    // Then steal from the back of the others
+    for (unsigned k = 1; k < participants; k++) {
+        Queue& victim = queues[(worker + k) % participants];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (victim.begin < victim.end) {
+            chunk = --victim.end;
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+// Small work-stealing pool for data-parallel loops over entity arrays.
+//
+// parallelFor splits [0, n) into chunks and hands every participant (the
+// workers and the calling thread) a contiguous run of them. A participant
+// takes chunks from the front of its own run; once that is empty it steals
+// from the back of the others. No allocation happens per call.
+
+#include <stddef.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Most worker threads a JobSystem starts, far past any core count, so a
+// bad count can't ask for billions
+const unsigned MAX_WORKERS = 256;
+
+// Reads a --threads value, a whole number from 0 to MAX_WORKERS. Prints
+// why and returns false for anything else
+bool parseWorkerCount(const char* text, unsigned& workers);
+
+struct JobSystem {
+    // Chunks [begin, end) still owned by one participant
+    struct alignas(64) Queue {
+        std::mutex lock;
+        size_t begin = 0;
+        size_t end = 0;
+    };
+
+    std::vector<std::thread> threads;
+    std::unique_ptr<Queue[]> queues;
+    unsigned participants = 1;
+
+    // Current loop, set by parallelFor
+    void (*job)(void* context, size_t begin, size_t end, unsigned worker) = nullptr;
+    void* context = nullptr;
+    size_t count = 0;
+    size_t chunkSize = 1;
+    std::atomic<size_t> chunksLeft{ 0 };
+
+    std::mutex wakeLock;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    uint64_t generation = 0;
+    unsigned running = 0;
+    bool stopping = false;
+
+    // workers extra threads besides the caller, at most MAX_WORKERS. With
+    // pinCores every thread, the caller included, is bound to one CPU in
+    // order
+    explicit JobSystem(unsigned workers = 0, bool pinCores = false);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Number of participants, workers plus the calling thread. Worker ids
+    // passed to jobs are below this
+    unsigned size() const {
+        return participants;
+    }
+
+    // Calls f(begin, end, worker) for chunks covering [0, n) and returns
+    // once all of them ran
+    template <typename F>
+    void parallelFor(size_t n, size_t chunk, F& f) {
+        run(n, chunk, [](void* c, size_t begin, size_t end, unsigned worker) {
+            (*static_cast<F*>(c))(begin, end, worker);
+        }, &f);
+    }
+
+    void run(size_t n, size_t chunk, void (*fn)(void*, size_t, size_t, unsigned), void* ctx);
+
+    void workerLoop(unsigned worker);
+
+    // Runs chunks until none are left anywhere
+    void drain(unsigned worker);
+
+    bool takeChunk(unsigned worker, size_t& chunk);
+};
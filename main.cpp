@@ -1,5 +1,6 @@
 #include "include/raylib.h"
 #include "include/raymath.h"
+#include "include/rlgl.h"
 #include <iostream>
 #include <assert.h>
 #include <math.h>
@@ -12,126 +13,55 @@
 #include <string.h>
 #include <vector>
 #include <array>
+#include <algorithm>
 #include <format>
-
-#define MAX_SHOTS 100
+#include <iterator>
+#include <time.h>
+#include <chrono>
+
+#include "simulation.h"
+#include "recording.h"
+#include "alloc_counter.h"
+#include "shape_renderer.h"
+#include "net_renderer.h"
+#include "hud_text.h"
+#include "trace.h"
+#include "histogram.h"
 
 #define INIT_SCREEN_WIDTH 1600
 #define INIT_SCREEN_HEIGHT 900
 #define INFO_TEXT_SIZE 26
 
+#define SHOT_RADIUS 5
+// Triangles of a shot around its center, built once
+#define SHOT_SEGMENTS 12
+
 #define NET_COLOR GRAY
 #define NET_BORDER_COLOR RED
 
-#define MAX_ASTEROIDS_COUNT 10
-
-const float ROTATION_SPEED = PI / 32;
-const float MAX_SPEED = 6;
-
-const int NET_GAP = 100;
-
-const int fieldWidth = 2000;
-const int fieldHeight = 2000;
-
 Font font;
 
-enum turn {
-    LEFT,
-    RIGHT,
-};
-
-enum move {
-    FORWARD,
-    BACKWARD,
-};
-
-struct Ship {
-    Vector2 dir = (Vector2){ 1, 0 };;
-    Vector2 pos = (Vector2){ fieldWidth / 2.0f, fieldHeight / 2.0f };
-    float speed = 0;
-    bool is_engine_working = false;
+// Global heap allocations made by the last frame, per tag
+AllocStats frameAllocations[ALLOC_TAG_COUNT];
 
-    void rotate(enum turn t) {
-        dir = Vector2Rotate(dir, t == LEFT ? -ROTATION_SPEED : ROTATION_SPEED);
-    }
+// Frames of the game screen after which --fail-on-alloc forbids
+// allocating. Toggling the debug display or resizing the window starts it
+// over
+const int ALLOC_WARMUP_FRAMES = 300;
 
-    void move(enum move m) {
-        if (m == FORWARD) {
-            if (speed < MAX_SPEED) {
-                speed += 0.2;
-            }
-            is_engine_working = true;
-        }
-        else if (m == BACKWARD) {
-            if (speed > -MAX_SPEED) {
-                speed -= 0.2;
-            }
-            is_engine_working = true;
-        }
-        else {
-            assert(false && "Unexpected move type");
-        }
-    }
-
-    void slowdown() {
-        if (speed != 0) {
-            Vector2 new_pos = Vector2Add(pos, Vector2Scale(dir, speed));
-
-            if (0 <= new_pos.x && new_pos.x < fieldWidth) {
-                pos.x = new_pos.x;
-            }
-
-            if (0 <= new_pos.y && new_pos.y < fieldHeight) {
-                pos.y = new_pos.y;
-            }
-
-            if (speed > 0) {
-                if (speed > 0.07) {
-                    speed -= 0.07;
-                }
-                else {
-                    speed = 0.0;
-                }
-            }
-
-            if (speed < 0) {
-                if (speed < 0.07) {
-                    speed += 0.07;
-                }
-                else {
-                    speed = 0.0;
-                }
-            }
-        }
-    }
-
-    std::array<Vector2, 3> getVertices() {
-        std::array<Vector2, 3> vs;
-        vs[0] = Vector2Scale(dir, 15);
-
-        float l = (3 * PI) / 4;
-        vs[1] = Vector2Rotate(vs[0], l);
-
-        float r = (5 * PI) / 4;
-        vs[2] = Vector2Rotate(vs[0], r);
-
-        return vs;
-    }
+// Field draw calls of the current frame, the HUD shows the previous one
+struct DrawStats {
+    uint64_t calls = 0;
+    uint64_t vertices = 0;
+    uint64_t flushes = 0;
+    uint64_t uploadBytes = 0;
 };
 
-struct Shot {
-    Vector2 pos;
-    Vector2 dir;
+DrawStats drawStats;
+DrawStats lastDrawStats;
 
-    bool isShotOnField() {
-        return 0 <= pos.x && pos.x <= fieldWidth && 0 <= pos.y && pos.y <= fieldHeight;
-    }
-
-    void move() {
-        Vector2 shot_speed = Vector2Scale(dir, 10);
-        pos = Vector2Add(pos, shot_speed);
-    }
-};
+size_t lastHudLines = 0;
+size_t lastHudRelayouts = 0;
 
 struct Screen {
     int w;
@@ -139,100 +69,38 @@ struct Screen {
     Vector2 center;
 };
 
-Vector2 centerPoint(std::vector<Vector2> vertices) {
-    float x = 0;
-    float y = 0;
-    float a = 0;
-
-    size_t n = vertices.size();
-
-    for (size_t i = 0; i < n; i++) {
-        float x1 = vertices[i].x;
-        float y1 = vertices[i].y;
-
-        float x2 = vertices[(i + 1) % n].x;
-        float y2 = vertices[(i + 1) % n].y;
-
-        a += x1 * y2 - x2 * y1;
-
-        float cross = (x1 * y2 - x2 * y1);
-        x += (x1 + x2) * cross;
-        y += (y1 + y2) * cross;
-    }
-
-    x /= (3 * a);
-    y /= (3 * a);
-
-    return Vector2{ x, y };
-}
-
-const float rotationAngle = 0.05;
-
-struct Asteroid {
-    Vector2 pos;
-    Vector2 dir;
-    std::vector<Vector2> vertices;
-    Vector2 polyCenter;
-
-    Asteroid() {}
-
-    Asteroid(Vector2 pos, Vector2 dir, std::vector<Vector2> vertices) : pos(pos), dir(dir), vertices(vertices) {
-        polyCenter = centerPoint(vertices);
-    }
-
-    void rotate() {
-        for (size_t i = 0; i < vertices.size(); i++) {
-            Vector2 p = vertices[i];
-            p = Vector2Subtract(p, polyCenter);
-            p = Vector2Rotate(p, rotationAngle);
-            p = Vector2Add(p, polyCenter);
-
-            vertices[i] = p;
-        }
-    }
-
-    void move() {
-        pos = Vector2Add(pos, dir);
-    }
-
-    bool isOnField(Screen& screen, Ship& ship) {
-        if (0 <= pos.x && pos.x <= fieldWidth && 0 <= pos.y && pos.y <= fieldHeight) {
-            return true;
-        }
-
-        for (Vector2 vertex : vertices) {
-            Vector2 p = Vector2Add(pos, vertex);
-            if (0 <= p.x && p.x <= fieldWidth && 0 <= p.y && p.y <= fieldHeight) {
-                return true;
-            }
-        }
-        return false;
-    }
-};
-
-void drawNet(Screen& screen, Ship& ship) {
+// One DrawLine per grid line, when there are no shaders
+void drawNetLines(Screen& screen, int startX, int startY) {
     // Net vertical
-    int startX = -fmod(ship.pos.x, NET_GAP);
-
     int finishX = screen.w;
 
-    for (int i = startX; i < finishX; i += NET_GAP) {
+    for (int i = startX; i < finishX; i += config.netGap) {
         int y1 = 0;
         int y2 = screen.h;
         DrawLine(i, y1, i, y2, NET_COLOR);
     }
 
-    int startY = -fmod(ship.pos.y, NET_GAP);
-
     int finishY = screen.h;
 
     // Net horizontal
-    for (int i = startY; i < finishY; i += NET_GAP) {
+    for (int i = startY; i < finishY; i += config.netGap) {
         int x1 = 0;
         int x2 = screen.w;
 
         DrawLine(x1, i, x2, i, NET_COLOR);
     }
+}
+
+void drawNet(NetRenderer& net, Screen& screen, Ship& ship) {
+    int startX = -fmod(ship.pos.x, config.netGap);
+    int startY = -fmod(ship.pos.y, config.netGap);
+
+    if (net.loaded()) {
+        drawNetShader(net, screen.w, screen.h, Vector2{ (float)-startX, (float)-startY }, config.netGap, NET_COLOR);
+    }
+    else {
+        drawNetLines(screen, startX, startY);
+    }
 
     // Border lines
 
@@ -241,8 +109,8 @@ void drawNet(Screen& screen, Ship& ship) {
         DrawLine(0, y, screen.w, y, NET_BORDER_COLOR);
     }
 
-    if (fieldHeight - ship.pos.y < screen.center.y) {
-        int gap = screen.center.y - (fieldHeight - ship.pos.y);
+    if (config.fieldHeight - ship.pos.y < screen.center.y) {
+        int gap = screen.center.y - (config.fieldHeight - ship.pos.y);
         int y = screen.h - gap;
         DrawLine(0, y, screen.w, y, NET_BORDER_COLOR);
     }
@@ -252,8 +120,8 @@ void drawNet(Screen& screen, Ship& ship) {
         DrawLine(x, 0, x, screen.h, NET_BORDER_COLOR);
     }
 
-    if (fieldWidth - ship.pos.x < screen.center.x) {
-        int gap = screen.center.x - (fieldWidth - ship.pos.x);
+    if (config.fieldWidth - ship.pos.x < screen.center.x) {
+        int gap = screen.center.x - (config.fieldWidth - ship.pos.x);
         int x = screen.w - gap;
         DrawLine(x, 0, x, screen.h, NET_BORDER_COLOR);
     }
@@ -277,64 +145,134 @@ void drawShip(Screen& screen, Ship& ship) {
     }
 }
 
-void drawInfo(Screen& screen, Ship& ship, std::vector<Shot>& shots, std::vector<Asteroid>& asteroids) {
+void drawInfo(Hud& hud, Ship& ship, Shots& shots, Asteroids& asteroids, size_t detailedAsteroids) {
     // Ship position on the field
     float leftPadding = 10;
     float topPadding = 10;
 
     Vector2 textPos{ leftPadding, topPadding };
+    float lineHeight = hud.fontSize;
 
-    {
-        std::string buf = std::format("FPS {:d}", GetFPS());
-        DrawTextEx(font, buf.c_str(), textPos, (float)font.baseSize, 2, LIGHTGRAY);
-        textPos.y += font.baseSize;
-    }
+    hudLine(hud, textPos, "FPS {:d}", GetFPS());
+    textPos.y += lineHeight;
 
-    {
-        std::string buf = std::format("Ship position ({:d}; {:d})", (int)ship.pos.x, (int)ship.pos.y);
-        DrawTextEx(font, buf.c_str(), textPos, (float)font.baseSize, 2, LIGHTGRAY);
-        textPos.y += font.baseSize;
-    }
+    hudLine(hud, textPos, "Ship position ({:d}; {:d})", (int)ship.pos.x, (int)ship.pos.y);
+    textPos.y += lineHeight;
 
-    {
-        std::string buf = std::format("Ship speed {:0.2f}", ship.speed);
-        DrawTextEx(font, buf.c_str(), textPos, (float)font.baseSize, 2, LIGHTGRAY);
-        textPos.y += font.baseSize;
-    }
+    hudLine(hud, textPos, "Ship speed {:0.2f}", ship.speed);
+    textPos.y += lineHeight;
 
     // Shots on the field
-    {
-        std::string buf = std::format("Shots {}", shots.size());
-        DrawTextEx(font, buf.c_str(), textPos, (float)font.baseSize, 2, LIGHTGRAY);
-        textPos.y += font.baseSize;
+    hudLine(hud, textPos, "Shots {}", shots.size());
+    textPos.y += lineHeight;
+
+    // Asteroids on the field, and how many got the full update
+    hudLine(hud, textPos, "Asteroids {} ({} detailed)", asteroids.size(), detailedAsteroids);
+    textPos.y += lineHeight;
+
+    // What culling left of the field
+    hudLine(hud, textPos, "Draw calls {} ({} vertices), {} flushes, {} bytes uploaded",
+        lastDrawStats.calls, lastDrawStats.vertices, lastDrawStats.flushes, lastDrawStats.uploadBytes);
+    textPos.y += lineHeight;
+
+    // Of the previous frame, lines are only laid out when they change
+    hudLine(hud, textPos, "HUD lines {} ({} laid out)", lastHudLines, lastHudRelayouts);
+    textPos.y += lineHeight;
+
+    // Heap allocations of the previous frame, 0 once warmed up
+    AllocStats total;
+    for (AllocStats& stats : frameAllocations) {
+        total.count += stats.count;
+        total.bytes += stats.bytes;
+    }
+
+    hudLine(hud, textPos, "Heap allocations {} ({} bytes)", total.count, total.bytes);
+    textPos.y += lineHeight;
+
+    for (int tag = 0; tag < ALLOC_TAG_COUNT; tag++) {
+        AllocStats& stats = frameAllocations[tag];
+        hudLine(hud, Vector2{ textPos.x + lineHeight, textPos.y }, "{} {} ({} bytes)", allocTagName((AllocTag)tag), stats.count, stats.bytes);
+        textPos.y += lineHeight;
     }
+}
+
+// One color per phase, in Phase order
+const Color PHASE_COLORS[PHASE_COUNT] = {
+    SKYBLUE, BLUE, DARKBLUE, PURPLE, VIOLET, MAGENTA, PINK,
+    LIME, GREEN, DARKGREEN, YELLOW, GOLD, ORANGE, MAROON,
+};
 
-    /*
-    {
-        for (Shot& shot : shots) {
-            std::string buf = std::format("({:0.2f}; {:0.2f})", shot.pos.x, shot.pos.y);
-            DrawTextEx(font, buf.c_str(), textPos, (float)font.baseSize, 2, LIGHTGRAY);
-            textPos.y += font.baseSize;
+// Milliseconds of a frame shown by the graph's full height, two frames at
+// 60 FPS
+const float TIMINGS_GRAPH_MS = 33.3f;
+
+// A bar per frame of the history, phases stacked bottom up, and the
+// min/avg/max of each phase next to it
+void drawTimings(Hud& hud, Screen& screen, const FrameTimings& timings) {
+    float graphHeight = 200;
+    float barWidth = 2;
+    float pixelsPerMs = graphHeight / TIMINGS_GRAPH_MS;
+
+    Vector2 origin = { 10, screen.h - 10.0f };
+
+    DrawRectangle((int)origin.x, (int)(origin.y - graphHeight), (int)(FrameTimings::HISTORY * barWidth), (int)graphHeight, Fade(BLACK, 0.5f));
+
+    for (size_t i = 0; i < timings.count; i++) {
+        const float* frame = timings.frame(i);
+        float x = origin.x + i * barWidth;
+        float y = origin.y;
+
+        for (int p = 0; p < PHASE_COUNT; p++) {
+            float h = frame[p] * pixelsPerMs;
+            if (h <= 0) {
+                continue;
+            }
+            // Bars past the top are cut off
+            h = fminf(h, y - (origin.y - graphHeight));
+            y -= h;
+            DrawRectangleV(Vector2{ x, y }, Vector2{ barWidth, h }, PHASE_COLORS[p]);
         }
     }
-    */
 
-    // Asteroids on the field
-    {
-        std::string buf = std::format("Asteroids {}", asteroids.size());
-        DrawTextEx(font, buf.c_str(), textPos, (float)font.baseSize, 2, LIGHTGRAY);
-        textPos.y += font.baseSize;
+    // A line at one 60 FPS frame
+    float frameY = origin.y - 16.7f * pixelsPerMs;
+    DrawLineV(Vector2{ origin.x, frameY }, Vector2{ origin.x + FrameTimings::HISTORY * barWidth, frameY }, LIGHTGRAY);
+
+    float lineHeight = hud.fontSize;
+    Vector2 textPos = { origin.x + FrameTimings::HISTORY * barWidth + 10, origin.y - (float)PHASE_COUNT * lineHeight };
+
+    // Asked for with --perf, but refused
+    if (timings.perf && !timings.perf->available()) {
+        hudLine(hud, Vector2{ textPos.x, textPos.y - lineHeight }, "Perf counters unavailable: {}", timings.perf->error);
     }
 
-    /*
-    {
-        for (Asteroid& a : asteroids) {
-            std::string buf = std::format("({:0.2f}; {:0.2f})", a.pos.x, a.pos.y);
-            DrawTextEx(font, buf.c_str(), textPos, (float)font.baseSize, 2, LIGHTGRAY);
-            textPos.y += font.baseSize;
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        Phase phase = (Phase)p;
+        PhaseStats s = timings.stats(phase);
+        Vector2 linePos = { textPos.x + lineHeight, textPos.y };
+
+        DrawRectangleV(Vector2{ textPos.x, textPos.y + lineHeight / 4 }, Vector2{ lineHeight / 2, lineHeight / 2 }, PHASE_COLORS[p]);
+
+        if (timings.counting() && !timings.counters[p].available()) {
+            hudLine(hud, linePos, "{} {:.2f} / {:.2f} / {:.2f} ms  counters n/a", phaseName(phase), s.min, s.avg, s.max);
         }
+        else if (timings.counting()) {
+            // Since the overlay was opened, misses per thousand instructions
+            const CounterValues& c = timings.counters[p];
+            float instructions = (float)c[COUNTER_INSTRUCTIONS];
+            float kilo = instructions > 0 ? 1000 / instructions : 0;
+
+            hudLine(hud, linePos, "{} {:.2f} / {:.2f} / {:.2f} ms  IPC {:.2f}  L1 {:.1f}  LLC {:.2f}  branch {:.1f}",
+                phaseName(phase), s.min, s.avg, s.max,
+                c[COUNTER_CYCLES] > 0 ? instructions / (float)c[COUNTER_CYCLES] : 0,
+                c[COUNTER_L1D_MISSES] * kilo, c[COUNTER_LLC_MISSES] * kilo, c[COUNTER_BRANCH_MISSES] * kilo);
+        }
+        else {
+            hudLine(hud, linePos, "{} {:.2f} / {:.2f} / {:.2f} ms", phaseName(phase), s.min, s.avg, s.max);
+        }
+
+        textPos.y += lineHeight;
     }
-    */
 }
 
 Vector2 fieldPosToScreenPos(Screen& screen, Ship& ship, Vector2 field_pos) {
@@ -343,131 +281,234 @@ Vector2 fieldPosToScreenPos(Screen& screen, Ship& ship, Vector2 field_pos) {
     return Vector2{ x, y };
 }
 
-void drawShots(Screen& screen, Ship& ship, std::vector<Shot>& shots) {
-    for (size_t i = 0; i < shots.size(); i++) {
-        Shot shot = shots[i];
+// Vertices reserved in the render batch for the ship, net and HUD, as
+// much as rlgl's default batch
+#define OVERLAY_VERTICES (4 * RL_DEFAULT_BATCH_BUFFER_ELEMENTS)
+
+#ifdef __EMSCRIPTEN__
+const size_t MAX_BATCH_VERTICES = 65536;
+#endif
 
-        Vector2 shot_point = fieldPosToScreenPos(screen, ship, shot.pos);
-        DrawCircleV(shot_point, 5, RED);
+// Position, texture coordinates and color of a vertex in rlgl's batch
+#define BATCH_VERTEX_BYTES (5 * sizeof(float) + 4)
+
+// Draws the visible asteroid outlines and shots. Outlines come from the
+// shapes' retained buffers, or without shaders from the render batch.
+// The batch is sized for what is on screen, so it isn't flushed every time
+// rlgl's default 8192 quads run out
+struct FieldRenderer {
+    rlRenderBatch batch = {};
+    // Vertices the batch can take before it has to flush
+    size_t capacity = 0;
+
+    ShapeRenderer shapes;
+
+    // Visible this frame, asteroids already interpolated. Only filled
+    // when the outlines go through the batch
+    std::vector<Asteroid> asteroids;
+    std::vector<Vector2> shots;
+    size_t lineVertices = 0;
+
+    std::array<Vector2, SHOT_SEGMENTS> circle;
+
+    // Flushes forced by a full batch this frame
+    uint64_t overflows = 0;
+};
+
+void initFieldRenderer(FieldRenderer& renderer) {
+    for (int i = 0; i < SHOT_SEGMENTS; i++) {
+        float a = 2 * PI * i / SHOT_SEGMENTS;
+        renderer.circle[i] = Vector2{ SHOT_RADIUS * cosf(a), SHOT_RADIUS * sinf(a) };
     }
+
+    // Everything could be on screen at once, reaching a new high must not
+    // allocate
+    if (!loadShapeRenderer(renderer.shapes, config.maxAsteroids)) {
+        TraceLog(LOG_WARNING, "No shaders, asteroid outlines go through the render batch");
+        renderer.asteroids.reserve(config.maxAsteroids);
+    }
+    renderer.shots.reserve(config.maxShots);
 }
 
-void drawAsteroid(Screen& screen, Ship& ship, Asteroid& asteroid) {
-    for (size_t i = 0, j = asteroid.vertices.size() - 1; i < asteroid.vertices.size(); j = i++) {
-        Vector2 p1 = fieldPosToScreenPos(screen, ship, Vector2Add(asteroid.pos, asteroid.vertices[i]));
-        Vector2 p2 = fieldPosToScreenPos(screen, ship, Vector2Add(asteroid.pos, asteroid.vertices[j]));
-        DrawLineV(p1, p2, WHITE);
+void unloadBatch(FieldRenderer& renderer) {
+    if (renderer.capacity > 0) {
+        rlSetRenderBatchActive(NULL);
+        rlUnloadRenderBatch(renderer.batch);
+        renderer.capacity = 0;
     }
 }
 
-Screen initScreen(int w, int h) {
-    return (Screen) {
-        .w = w,
-            .h = h,
-            .center = (Vector2){
-                .x = w / 2.0f,
-                .y = h / 2.0f,
-        },
-    };
+void unloadFieldRenderer(FieldRenderer& renderer) {
+    unloadShapeRenderer(renderer.shapes);
+    unloadBatch(renderer);
 }
 
-void addShot(Screen& screen, std::vector<Shot>& shots, Ship& ship) {
-    if (shots.size() < MAX_SHOTS) {
-        Shot shot = {
-            .pos = ship.pos,
-            .dir = Vector2Scale(Vector2Normalize(ship.dir), 1),
-        };
+// Makes the active batch hold at least vertices, must be called outside
+// BeginDrawing/EndDrawing. Grows by half again so small changes in what is
+// visible don't reload it
+void reserveBatch(FieldRenderer& renderer, size_t vertices) {
+#ifdef __EMSCRIPTEN__
+    // WebGL 1 indexes the batch with 16 bit indices, past that it flushes
+    vertices = std::min(vertices, MAX_BATCH_VERTICES);
+#endif
+
+    if (vertices <= renderer.capacity) {
+        return;
+    }
+
+    unloadBatch(renderer);
+
+    size_t capacity = vertices + vertices / 2;
+#ifdef __EMSCRIPTEN__
+    capacity = std::min(capacity, MAX_BATCH_VERTICES);
+#endif
+    // rlgl counts its buffer in quads
+    renderer.batch = rlLoadRenderBatch(1, (int)((capacity + 3) / 4));
+    renderer.capacity = capacity;
+    rlSetRenderBatchActive(&renderer.batch);
+}
 
-        shots.push_back(shot);
-    }
+// Part of the field shown on the screen
+Bounds screenBounds(Screen& screen, Ship& ship) {
+    return Bounds{
+        ship.pos.x - screen.center.x,
+        ship.pos.y - screen.center.y,
+        ship.pos.x - screen.center.x + screen.w,
+        ship.pos.y - screen.center.y + screen.h,
+    };
 }
 
-void moveShots(std::vector<Shot>& shots) {
-    std::vector<size_t> to_remove;
+// Collects what is on screen and sizes the batch for it
+void cullField(FieldRenderer& renderer, Screen& screen, Ship& ship, World& world, float alpha) {
+    Bounds visible = screenBounds(screen, ship);
+    const Asteroids& asteroids = world.asteroids;
+
+    renderer.asteroids.clear();
+    clearShapeInstances(renderer.shapes);
+    renderer.shots.clear();
+    renderer.lineVertices = 0;
+
+    for (size_t i = 0; i < asteroids.size(); i++) {
+        // The view and a chunk around it are always detailed, so anything
+        // elsewhere is off screen. Saves interpolating far asteroids
+        if (!world.chunks.isDetailed(asteroids.x[i], asteroids.y[i])) {
+            continue;
+        }
 
-    for (size_t i = 0; i < shots.size(); i++) {
-        Shot& shot = shots[i];
+        Asteroid asteroid = asteroids.interpolated(i, alpha);
+        if (!asteroid.bounds.overlaps(visible)) {
+            continue;
+        }
 
-        if (shot.isShotOnField()) {
-            shot.move();
+        if (renderer.shapes.loaded()) {
+            Vector2 center = fieldPosToScreenPos(screen, ship, asteroid.center());
+            addShapeInstance(renderer.shapes, asteroid.shape, center, asteroid.cosAngle, asteroid.sinAngle);
         }
         else {
-            to_remove.push_back(i);
+            renderer.asteroids.push_back(asteroid);
+            renderer.lineVertices += 2 * asteroid.getShape().vertices.size();
         }
     }
 
-    for (size_t i = to_remove.size(); i-- > 0; ) {
-        shots.erase(shots.begin() + to_remove[i]);
+    for (size_t i = 0; i < world.shots.size(); i++) {
+        Vector2 pos = world.shots.interpolatedPos(i, alpha);
+        Bounds shot = { pos.x - SHOT_RADIUS, pos.y - SHOT_RADIUS, pos.x + SHOT_RADIUS, pos.y + SHOT_RADIUS };
+        if (shot.overlaps(visible)) {
+            renderer.shots.push_back(pos);
+        }
     }
-}
-
-bool CheckAsteroidCollision(Vector2 p, std::vector<Vector2>& points) {
-    assert(points.size() > 1);
 
-    bool inside = false;
+    size_t shotVertices = renderer.shots.size() * 3 * SHOT_SEGMENTS;
+    reserveBatch(renderer, renderer.lineVertices + shotVertices + OVERLAY_VERTICES);
+}
 
-    size_t count = points.size();
+// Every outline in one run of lines of the batch
+void drawOutlines(FieldRenderer& renderer, Screen& screen, Ship& ship) {
+    rlBegin(RL_LINES);
+    rlColor4ub(WHITE.r, WHITE.g, WHITE.b, WHITE.a);
 
-    for (size_t i = 0, j = count - 1; i < count; j = i++) {
-        Vector2 p1 = points[i];
-        Vector2 p2 = points[j];
+    for (Asteroid& asteroid : renderer.asteroids) {
+        const std::vector<Vector2>& vertices = asteroid.getShape().vertices;
 
-        // Check if edge (i,j) crosses a horizontal ray to the right of the point
-        bool intersect = ((p1.y > p.y) != (p2.y > p.y)) &&
-            (p.x < (p2.x - p1.x) * (p.y - p1.y) / (p2.y - p1.y + 0.000001f) + p1.x);
+        if (rlCheckRenderBatchLimit(2 * (int)vertices.size())) {
+            renderer.overflows++;
+        }
 
-        if (intersect) {
-            inside = !inside;
+        for (size_t i = 0, j = vertices.size() - 1; i < vertices.size(); j = i++) {
+            Vector2 p1 = fieldPosToScreenPos(screen, ship, asteroid.toField(vertices[i]));
+            Vector2 p2 = fieldPosToScreenPos(screen, ship, asteroid.toField(vertices[j]));
+            rlVertex2f(p1.x, p1.y);
+            rlVertex2f(p2.x, p2.y);
         }
     }
 
-    return inside;
+    rlEnd();
+
+    drawStats.calls++;
+    drawStats.vertices += renderer.lineVertices;
+    drawStats.uploadBytes += renderer.lineVertices * BATCH_VERTEX_BYTES;
 }
 
-std::vector<std::vector<Vector2>> asteroidsLibarary = {
-    std::vector<Vector2> {
-        Vector2{ 51, 78 },
-        Vector2{ -15, 99 },
-        Vector2{ -20, 0 },
-        Vector2{ 0, -40 },
-        Vector2{ 82, -48 },
-        Vector2{ 126, 12 },
+void drawField(FieldRenderer& renderer, Screen& screen, Ship& ship) {
+    renderer.overflows = 0;
+
+    if (renderer.shapes.loaded()) {
+        drawShapes(renderer.shapes, WHITE);
+        drawStats.calls += renderer.shapes.drawCalls;
+        drawStats.vertices += renderer.shapes.vertices;
+        drawStats.uploadBytes += renderer.shapes.uploadBytes;
+        // drawShapes flushes what was drawn before it
+        drawStats.flushes++;
+    }
+    else {
+        drawOutlines(renderer, screen, ship);
     }
-};
 
-Asteroid getRandAsteroid() {
-    int i = GetRandomValue(0, asteroidsLibarary.size() - 1);
+    // Shots as a fan of triangles around each center
+    rlBegin(RL_TRIANGLES);
+    rlColor4ub(RED.r, RED.g, RED.b, RED.a);
 
-    int side = GetRandomValue(0, 3);
+    for (Vector2 pos : renderer.shots) {
+        Vector2 c = fieldPosToScreenPos(screen, ship, pos);
 
-    Vector2 pos;
-    Vector2 dir;
-    Asteroid asteroid;
+        if (rlCheckRenderBatchLimit(3 * SHOT_SEGMENTS)) {
+            renderer.overflows++;
+        }
 
-    if (side == 0) { // top
-        pos = Vector2{ (float)GetRandomValue(0, fieldWidth), 0 };
-        dir = Vector2{ (float)GetRandomValue(1, 3), (float)GetRandomValue(1, 3) };
-    }
-    else if (side == 1) { // right
-        pos = Vector2{ 0, (float)GetRandomValue(0, fieldHeight) };
-        dir = Vector2{ (float)GetRandomValue(1, 3), (float)GetRandomValue(-3, 3) };
-    }
-    else if (side == 2) { // bottom
-        pos = Vector2{ (float)GetRandomValue(0, fieldWidth), fieldHeight };
-        dir = Vector2{ (float)GetRandomValue(-3, 3), (float)GetRandomValue(-3, -1) };
-    }
-    else { // left
-        pos = Vector2{ 0, (float)GetRandomValue(0, fieldHeight) };
-        dir = Vector2{ (float)GetRandomValue(1, 3), (float)GetRandomValue(-3, 3) };
+        for (int i = 0; i < SHOT_SEGMENTS; i++) {
+            Vector2 a = renderer.circle[i];
+            Vector2 b = renderer.circle[(i + 1) % SHOT_SEGMENTS];
+            // Counter-clockwise on screen
+            rlVertex2f(c.x, c.y);
+            rlVertex2f(c.x + b.x, c.y + b.y);
+            rlVertex2f(c.x + a.x, c.y + a.y);
+        }
     }
 
-    return Asteroid(pos, dir, asteroidsLibarary[i]);
+    rlEnd();
+
+    size_t shotVertices = renderer.shots.size() * 3 * SHOT_SEGMENTS;
+    drawStats.calls++;
+    drawStats.vertices += shotVertices;
+    drawStats.uploadBytes += shotVertices * BATCH_VERTEX_BYTES;
+    // The one left is EndDrawing's
+    drawStats.flushes += renderer.overflows + 1;
 }
 
-void drawScore(Screen& screen, uint64_t score) {
+Screen initScreen(int w, int h) {
+    return (Screen) {
+        .w = w,
+            .h = h,
+            .center = (Vector2){
+                .x = w / 2.0f,
+                .y = h / 2.0f,
+        },
+    };
+}
+
+void drawScore(Hud& hud, Screen& screen, uint64_t score) {
     Vector2 textPos = { screen.w / 2.0f, 10 };
-    std::string buf = std::format("Score {:d}", score);
-    DrawTextEx(font, buf.c_str(), textPos, (float)font.baseSize, 2, LIGHTGRAY);
+    hudLine(hud, textPos, "Score {:d}", score);
 }
 
 enum class GameScreen {
@@ -475,7 +516,68 @@ enum class GameScreen {
     GAME,
 };
 
-int main(void) {
+int main(int argc, char** argv) {
+    // Simulation ticks per second, independent of the frame rate.
+    // 0 for --fps leaves rendering uncapped
+    float tickRate = BASE_TICK_RATE;
+    int targetFps = 60;
+    // Worker threads for the asteroid pass, and whether to pin them and
+    // the main thread to one CPU each
+    unsigned threads = 0;
+    bool pin = false;
+    // Where to save the game's recording at exit, for ./headless --replay
+    const char* recordPath = NULL;
+    // Where to write the trace of the last frames at exit
+    const char* tracePath = NULL;
+    // Where to write the frame and tick time histograms at exit
+    const char* histogramPath = NULL;
+    // Hardware counters per phase in the debug display
+    bool countPerf = false;
+    // Abort on any heap allocation once the game has warmed up
+    bool failOnAlloc = false;
+
+    // Field size and limits come from --config, --preset or the single options
+    for (int i = 1; i < argc; i++) {
+        ConfigArg configArg = parseConfigArg(argc, argv, i, config);
+        if (configArg == CONFIG_ARG_ERROR) {
+            return 1;
+        }
+        else if (configArg == CONFIG_ARG_OK) {
+            continue;
+        }
+        else if (strcmp(argv[i], "--tick-rate") == 0 && i + 1 < argc) {
+            if (!parseTickRate(argv[++i], tickRate)) {
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            targetFps = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            if (!parseWorkerCount(argv[++i], threads)) {
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--pin") == 0) {
+            pin = true;
+        }
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            tracePath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--histogram") == 0 && i + 1 < argc) {
+            histogramPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--perf") == 0) {
+            countPerf = true;
+        }
+        else if (strcmp(argv[i], "--fail-on-alloc") == 0) {
+            failOnAlloc = true;
+        }
+    }
+
     // Initialization
     //--------------------------------------------------------------------------------------
     SetConfigFlags(FLAG_WINDOW_RESIZABLE);
@@ -487,29 +589,101 @@ int main(void) {
         TraceLog(LOG_ERROR, "Failed to load font!");
     }
 
-    SetTargetFPS(60);
+    Hud hud;
+    hud.font = font.texture.id != 0 ? font : GetFontDefault();
+    hud.fontSize = (float)hud.font.baseSize;
+
+    SetTargetFPS(targetFps);
+
+    FieldRenderer renderer;
+    initFieldRenderer(renderer);
+
+    NetRenderer net;
+    if (!loadNetRenderer(net)) {
+        TraceLog(LOG_WARNING, "No shaders, the background grid is drawn line by line");
+    }
 
     //--------------------------------------------------------------------------------------
 
     bool debugDisplay = false;
 
+    // Filled only while the debug display is on
+    FrameTimings timings;
+
+    // Counters of the main thread, which draws and runs the ticks
+    PerfCounters perf;
+    if (countPerf) {
+        if (!perf.open()) {
+            TraceLog(LOG_WARNING, "Perf counters unavailable: %s", perf.error);
+        }
+        timings.perf = &perf;
+    }
+
     GameScreen gameScreen = GameScreen::TITLE;
 
-    uint64_t score = 0;
+    JobSystem jobs(threads, pin);
 
-    Ship ship;
+    uint64_t seed = (uint64_t)time(NULL);
 
-    std::vector<Shot> shots;
+    World world(seed, tickRate);
+    if (threads > 0) {
+        world.jobs = &jobs;
+    }
+    world.timings = &timings;
+
+    Recording recording = beginRecording(seed, tickRate, config);
+    if (recordPath) {
+        // An hour of ticks up front, it grows between ticks after that
+        recording.inputs.reserve((size_t)(3600 * tickRate));
+    }
+
+    // Fixed timestep: real time is accumulated and spent in whole ticks,
+    // the remainder is used to interpolate the drawing
+    const float tickDt = 1.0f / tickRate;
+    // Ticks missed beyond this are dropped instead of caught up
+    const float maxFrameTime = 0.25f;
+    float accumulator = 0;
+
+    // A press lasts one frame, it is kept until a tick consumes it
+    bool firePending = false;
+    bool debugPending = false;
 
     Screen screen = initScreen(GetScreenWidth(), GetScreenHeight());
 
-    std::vector<Asteroid> asteroids;
+    // Frames are long enough to trace every phase
+    if (tracePath) {
+        startTracing(TRACE_PHASES, threads);
+    }
+
+    // Of the game screen, printed at exit. A frame lasts from the start of
+    // one to the start of the next, waiting for the frame rate included
+    Histogram frameTimes("frame");
+    Histogram tickTimes("tick");
+    std::chrono::steady_clock::time_point frameStart;
+    bool frameStarted = false;
+
+    // Game frames left until allocations are forbidden
+    int allocWarmup = ALLOC_WARMUP_FRAMES;
 
     while (!WindowShouldClose()) {
+        TraceScope traceFrame("frame");
+
+        AllocStats allocationsAtFrameStart[ALLOC_TAG_COUNT];
+        for (int tag = 0; tag < ALLOC_TAG_COUNT; tag++) {
+            allocationsAtFrameStart[tag] = allocationStats((AllocTag)tag);
+        }
+
         if (IsWindowResized()) {
             screen = initScreen(GetScreenWidth(), GetScreenHeight());
+
+            // The render batch and the HUD grow to the new size
+            forbidAllocations(false);
+            allocWarmup = ALLOC_WARMUP_FRAMES;
         }
 
+        // The ship is drawn in the middle, the window is the detailed area
+        world.viewHalfSize = screen.center;
+
         if (gameScreen == GameScreen::TITLE) {
             if (IsKeyPressed(KEY_ENTER)) {
                 gameScreen = GameScreen::GAME;
@@ -519,133 +693,188 @@ int main(void) {
 
             ClearBackground(DARKGRAY);
 
-            std::string text = "Press Enter to start";
-            Vector2 textSize = MeasureTextEx(font, text.c_str(), font.baseSize, 2);
+            const char* text = "Press Enter to start";
+            Vector2 textSize = MeasureTextEx(font, text, font.baseSize, 2);
 
             Vector2 textPos = {(screen.w / 2) - (textSize.x / 2), (screen.h / 2) - (textSize.y / 2)};
             
-            DrawTextEx(font, text.c_str(), textPos, (float)font.baseSize, 2, LIGHTGRAY);
+            DrawTextEx(font, text, textPos, (float)font.baseSize, 2, LIGHTGRAY);
             
             EndDrawing();
         }
         else if (gameScreen == GameScreen::GAME) {
-            ship.is_engine_working = false;
-
-            if (IsKeyPressed(KEY_SPACE) || IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
-                addShot(screen, shots, ship);
+            auto now = std::chrono::steady_clock::now();
+            if (frameStarted) {
+                frameTimes.record(std::chrono::duration_cast<std::chrono::nanoseconds>(now - frameStart).count());
             }
+            frameStart = now;
+            frameStarted = true;
 
-            if (IsKeyDown(KEY_LEFT) || IsKeyDown(KEY_A)) {
-                ship.rotate(LEFT);
-            }
+            if (IsKeyPressed(KEY_L)) {
+                debugDisplay = !debugDisplay;
+                debugPending = true;
 
-            if (IsKeyDown(KEY_RIGHT) || IsKeyDown(KEY_D)) {
-                ship.rotate(RIGHT);
-            }
+                // Starts over, frames from before are long gone
+                timings.enabled = debugDisplay;
+                timings.reset();
 
-            if (IsKeyDown(KEY_UP) || IsKeyDown(KEY_W)) {
-                ship.move(FORWARD);
+                // New HUD lines are laid out
+                forbidAllocations(false);
+                allocWarmup = ALLOC_WARMUP_FRAMES;
             }
 
-            if (IsKeyDown(KEY_DOWN) || IsKeyDown(KEY_S)) {
-                ship.move(BACKWARD);
-            }
+            Input input;
+            {
+                PhaseTimer timer(&timings, PHASE_INPUT);
 
-            if (IsKeyPressed(KEY_L)) {
-                debugDisplay = !debugDisplay;
+                firePending = firePending || IsKeyPressed(KEY_SPACE) || IsMouseButtonPressed(MOUSE_BUTTON_LEFT);
+                input.rotateLeft = IsKeyDown(KEY_LEFT) || IsKeyDown(KEY_A);
+                input.rotateRight = IsKeyDown(KEY_RIGHT) || IsKeyDown(KEY_D);
+                input.forward = IsKeyDown(KEY_UP) || IsKeyDown(KEY_W);
+                input.backward = IsKeyDown(KEY_DOWN) || IsKeyDown(KEY_S);
             }
 
-            ship.slowdown();
+            accumulator += fminf(GetFrameTime(), maxFrameTime);
+
+            // The recording doubles between ticks with a minute of room
+            // left, allowed even under --fail-on-alloc, so pushing a tick's
+            // input never allocates
+            size_t recordingMargin = (size_t)(60 * tickRate);
+            if (recordPath && recording.inputs.capacity() - recording.inputs.size() < recordingMargin) {
+                AllocScope scope(ALLOC_IO);
+                forbidAllocations(false);
+                recording.inputs.reserve(2 * recording.inputs.capacity() + recordingMargin);
+                forbidAllocations(failOnAlloc && allocWarmup == 0);
+            }
 
-            moveShots(shots);
+            while (accumulator >= tickDt) {
+                input.fire = firePending;
+                input.debug = debugPending;
+                firePending = false;
+                debugPending = false;
+
+                {
+                    AllocScope scope(ALLOC_SIMULATION);
+                    auto tickStart = std::chrono::steady_clock::now();
+                    world.step(input);
+                    auto tickEnd = std::chrono::steady_clock::now();
+                    tickTimes.record(std::chrono::duration_cast<std::chrono::nanoseconds>(tickEnd - tickStart).count());
+                    if (tracingEnabled()) {
+                        traceEvent("tick", tickStart, tickEnd);
+                    }
+                }
 
-            for (size_t i = 0; i < MAX_ASTEROIDS_COUNT - asteroids.size(); i++) {
-                asteroids.push_back(getRandAsteroid());
+                if (recordPath) {
+                    AllocScope scope(ALLOC_IO);
+                    recording.inputs.push_back(input.bits());
+                }
+                accumulator -= tickDt;
             }
 
+            float alpha = accumulator / tickDt;
+
+            Ship ship = world.ship.interpolated(alpha);
+
             {
-                std::vector<size_t> asteroids_to_remove;
-                std::vector<size_t> shots_to_remove;
+                PhaseTimer timer(&timings, PHASE_CULL);
+                AllocScope scope(ALLOC_RENDER);
+                cullField(renderer, screen, ship, world, alpha);
+            }
 
-                for (size_t i = 0; i < asteroids.size(); i++) {
-                    Asteroid& asteroid = asteroids[i];
+            BeginDrawing();
 
-                    asteroid.rotate();
-                    asteroid.move();
+            ClearBackground(DARKGRAY);
 
-                    // is on field?
-                    if (!asteroid.isOnField(screen, ship)) {
-                        asteroids_to_remove.push_back(i);
-                        continue;
-                    }
+            {
+                PhaseTimer timer(&timings, PHASE_DRAW_NET);
+                AllocScope scope(ALLOC_RENDER);
+                drawNet(net, screen, ship);
+            }
 
-                    std::vector<Vector2> asteroidVertices;
-                    for (Vector2 v : asteroid.vertices) {
-                        Vector2 p = Vector2Add(asteroid.pos, v);
-                        asteroidVertices.push_back(p);
-                    }
+            {
+                PhaseTimer timer(&timings, PHASE_DRAW_SHIP);
+                AllocScope scope(ALLOC_RENDER);
+                drawShip(screen, ship);
+            }
 
-                    // check ship collision
+            {
+                PhaseTimer timer(&timings, PHASE_DRAW_FIELD);
+                AllocScope scope(ALLOC_RENDER);
+                drawField(renderer, screen, ship);
+            }
 
-                    auto [v1, v2, v3] = ship.getVertices();
-                    v1 = Vector2Add(ship.pos, v1);
-                    v2 = Vector2Add(ship.pos, v2);
-                    v3 = Vector2Add(ship.pos, v3);
+            {
+                PhaseTimer timer(&timings, PHASE_DRAW_HUD);
+                AllocScope scope(ALLOC_HUD);
 
-                    if (CheckAsteroidCollision(v1, asteroidVertices) ||
-                        CheckAsteroidCollision(v2, asteroidVertices) ||
-                        CheckAsteroidCollision(v3, asteroidVertices)) {
-                        asteroids_to_remove.push_back(i);
-                        continue;
-                    }
+                beginHud(hud);
 
-                    for (size_t j = 0; j < shots.size(); j++) {
-                        Shot& shot = shots[j];
-                        if (CheckAsteroidCollision(shot.pos, asteroidVertices)) {
-                            shots_to_remove.push_back(j);
-                            asteroids_to_remove.push_back(i);
-                            score++;
-                        }
-                    }
-                }
+                drawScore(hud, screen, world.score);
 
-                for (size_t i = asteroids_to_remove.size(); i-- > 0; ) {
-                    asteroids.erase(asteroids.begin() + asteroids_to_remove[i]);
+                if (debugDisplay) {
+                    drawInfo(hud, ship, world.shots, world.asteroids, world.detailedAsteroids);
+                    drawTimings(hud, screen, timings);
                 }
 
-                for (size_t i = shots_to_remove.size(); i-- > 0; ) {
-                    shots.erase(shots.begin() + shots_to_remove[i]);
-                }
+                drawHud(hud);
+                lastHudLines = hud.used;
+                lastHudRelayouts = hud.relayouts;
             }
 
-            BeginDrawing();
-
-            ClearBackground(DARKGRAY);
-
-            drawNet(screen, ship);
-            drawShip(screen, ship);
-
-            drawShots(screen, ship, shots);
+            {
+                // Flushes the batch, swaps buffers and waits for the frame
+                // rate
+                PhaseTimer timer(&timings, PHASE_PRESENT);
+                EndDrawing();
+            }
 
-            for (Asteroid& asteroid : asteroids) {
-                drawAsteroid(screen, ship, asteroid);
+            if (timings.enabled) {
+                timings.endFrame();
             }
 
-            drawScore(screen, score);
+            lastDrawStats = drawStats;
+            drawStats = DrawStats();
 
-            if (debugDisplay) {
-                drawInfo(screen, ship, shots, asteroids);
+            if (failOnAlloc && allocWarmup > 0 && --allocWarmup == 0) {
+                forbidAllocations(true);
             }
+        }
 
-            EndDrawing();
+        for (int tag = 0; tag < ALLOC_TAG_COUNT; tag++) {
+            AllocStats now = allocationStats((AllocTag)tag);
+            frameAllocations[tag].count = now.count - allocationsAtFrameStart[tag].count;
+            frameAllocations[tag].bytes = now.bytes - allocationsAtFrameStart[tag].bytes;
         }
     }
 
+    forbidAllocations(false);
+
     // De-Initialization
     //--------------------------------------------------------------------------------------
+    unloadFieldRenderer(renderer);
+    unloadNetRenderer(net);
     CloseWindow(); // Close window and OpenGL context
     //--------------------------------------------------------------------------------------
 
+    if (tracePath) {
+        stopTracing();
+        if (writeTrace(tracePath)) {
+            std::cout << "Traced " << traceEventCount() << " events to " << tracePath << std::endl;
+        }
+    }
+
+    if (recordPath && saveRecording(recordPath, recording)) {
+        std::cout << "Recorded " << recording.inputs.size() << " ticks to " << recordPath
+            << ", final hash " << std::hex << world.hash() << std::dec << std::endl;
+    }
+
+    printPercentiles(frameTimes, "ms");
+    printPercentiles(tickTimes, "us");
+
+    if (histogramPath) {
+        writeHistograms(histogramPath, { &frameTimes, &tickTimes });
+    }
+
     std::cout << "Buy!" << std::endl;
 
     return 0;
@@ -0,0 +1,117 @@
+#include "net_renderer.h"
+
+#include "include/rlgl.h"
+
+#include <string>
+
+static const char* vertexShader330 = R"(#version 330
+in vec3 vertexPosition;
+uniform mat4 mvp;
+
+void main() {
+    gl_Position = mvp * vec4(vertexPosition, 1.0);
+}
+)";
+
+static const char* fragmentShader330 = R"(#version 330
+uniform vec2 offset;
+uniform float gap;
+uniform float screenHeight;
+uniform vec4 color;
+out vec4 finalColor;
+
+void main() {
+    // Pixel column and row, rows counted from the top like raylib
+    vec2 pixel = vec2(floor(gl_FragCoord.x), screenHeight - 1.0 - floor(gl_FragCoord.y));
+    vec2 cell = mod(pixel + offset, gap);
+
+    if (cell.x != 0.0 && cell.y != 0.0) {
+        discard;
+    }
+
+    finalColor = color;
+}
+)";
+
+// GLSL 100/120, the version line is added at load
+static const char* vertexShader100 = R"(
+attribute vec3 vertexPosition;
+uniform mat4 mvp;
+
+void main() {
+    gl_Position = mvp * vec4(vertexPosition, 1.0);
+}
+)";
+
+static const char* fragmentShader100 = R"(
+uniform vec2 offset;
+uniform float gap;
+uniform float screenHeight;
+uniform vec4 color;
+
+void main() {
+    vec2 pixel = vec2(floor(gl_FragCoord.x), screenHeight - 1.0 - floor(gl_FragCoord.y));
+    vec2 cell = mod(pixel + offset, gap);
+
+    if (cell.x != 0.0 && cell.y != 0.0) {
+        discard;
+    }
+
+    gl_FragColor = color;
+}
+)";
+
+bool loadNetRenderer(NetRenderer& renderer) {
+    int version = rlGetVersion();
+
+    if (version == RL_OPENGL_11) {
+        return false;
+    }
+
+    Shader shader;
+
+    if (version == RL_OPENGL_33 || version == RL_OPENGL_43) {
+        shader = LoadShaderFromMemory(vertexShader330, fragmentShader330);
+    }
+    else {
+        bool es = version == RL_OPENGL_ES_20 || version == RL_OPENGL_ES_30;
+        std::string vs = std::string(es ? "#version 100\n" : "#version 120\n") + vertexShader100;
+        std::string fs = std::string(es ? "#version 100\nprecision highp float;\n" : "#version 120\n") + fragmentShader100;
+        shader = LoadShaderFromMemory(vs.c_str(), fs.c_str());
+    }
+
+    // A failed compile falls back to the default shader
+    if (shader.id == 0 || shader.id == rlGetShaderIdDefault()) {
+        return false;
+    }
+
+    renderer.shader = shader;
+    renderer.offsetLoc = GetShaderLocation(shader, "offset");
+    renderer.gapLoc = GetShaderLocation(shader, "gap");
+    renderer.screenHeightLoc = GetShaderLocation(shader, "screenHeight");
+    renderer.colorLoc = GetShaderLocation(shader, "color");
+
+    return true;
+}
+
+void unloadNetRenderer(NetRenderer& renderer) {
+    if (renderer.loaded()) {
+        UnloadShader(renderer.shader);
+        renderer.shader = Shader{};
+    }
+}
+
+void drawNetShader(NetRenderer& renderer, int screenWidth, int screenHeight, Vector2 offset, int gap, Color color) {
+    float g = (float)gap;
+    float h = (float)screenHeight;
+    Vector4 c = ColorNormalize(color);
+
+    SetShaderValue(renderer.shader, renderer.offsetLoc, &offset, SHADER_UNIFORM_VEC2);
+    SetShaderValue(renderer.shader, renderer.gapLoc, &g, SHADER_UNIFORM_FLOAT);
+    SetShaderValue(renderer.shader, renderer.screenHeightLoc, &h, SHADER_UNIFORM_FLOAT);
+    SetShaderValue(renderer.shader, renderer.colorLoc, &c, SHADER_UNIFORM_VEC4);
+
+    BeginShaderMode(renderer.shader);
+    DrawRectangle(0, 0, screenWidth, screenHeight, WHITE);
+    EndShaderMode();
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+// Background grid drawn as one screen-sized rectangle by a fragment shader
+// that picks the grid pixels from the ship offset and the grid spacing, so
+// its cost doesn't depend on how many lines are on screen.
+
+#include "include/raylib.h"
+
+struct NetRenderer {
+    Shader shader = {};
+    int offsetLoc = -1;
+    int gapLoc = -1;
+    int screenHeightLoc = -1;
+    int colorLoc = -1;
+
+    bool loaded() const {
+        return shader.id != 0;
+    }
+};
+
+// Returns false, leaving the renderer unloaded, when the GL version has no
+// shaders
+bool loadNetRenderer(NetRenderer& renderer);
+
+void unloadNetRenderer(NetRenderer& renderer);
+
+// Lines go through the screen pixels x and y where x + offset.x and
+// y + offset.y are multiples of gap
+void drawNetShader(NetRenderer& renderer, int screenWidth, int screenHeight, Vector2 offset, int gap, Color color);
@@ -0,0 +1,166 @@
+#include "perf_counters.h"
+
+#if defined(__linux__) && !defined(__EMSCRIPTEN__)
+#define HAVE_PERF_EVENTS 1
+#include <errno.h>
+#include <string.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+const char* counterName(Counter counter) {
+    switch (counter) {
+    case COUNTER_CYCLES: return "cycles";
+    case COUNTER_INSTRUCTIONS: return "instructions";
+    case COUNTER_L1D_MISSES: return "l1d-misses";
+    case COUNTER_LLC_MISSES: return "llc-misses";
+    case COUNTER_BRANCH_MISSES: return "branch-misses";
+    case COUNTER_COUNT: break;
+    }
+    return "?";
+}
+
+PerfCounters::~PerfCounters() {
+    close();
+}
+
+#if HAVE_PERF_EVENTS
+
+static void setEvent(perf_event_attr& attr, Counter counter) {
+    switch (counter) {
+    case COUNTER_CYCLES:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CPU_CYCLES;
+        break;
+    case COUNTER_INSTRUCTIONS:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+    case COUNTER_L1D_MISSES:
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_L1D |
+            (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+            (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        break;
+    case COUNTER_LLC_MISSES:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        break;
+    case COUNTER_BRANCH_MISSES:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+        break;
+    case COUNTER_COUNT:
+        break;
+    }
+}
+
+static const char* openError(int error) {
+    switch (error) {
+    case ENOENT:
+    case ENODEV:
+    case EOPNOTSUPP:
+        return "no hardware counters on this machine";
+    case EACCES:
+    case EPERM:
+        return "not permitted, see /proc/sys/kernel/perf_event_paranoid";
+    case ENOSYS:
+        return "no perf_event_open in this kernel";
+    default:
+        return "perf_event_open failed";
+    }
+}
+
+bool PerfCounters::open() {
+    close();
+
+    int firstError = 0;
+
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        setEvent(attr, (Counter)c);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        // The group starts at once below
+        attr.disabled = leader < 0;
+
+        // This thread, any CPU
+        int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+        if (fd < 0) {
+            if (firstError == 0) {
+                firstError = errno;
+            }
+            continue;
+        }
+
+        if (leader < 0) {
+            leader = fd;
+        }
+        fds[c] = fd;
+        order[opened++] = (Counter)c;
+    }
+
+    if (leader < 0) {
+        error = openError(firstError);
+        return false;
+    }
+
+    ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return true;
+}
+
+void PerfCounters::close() {
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        if (fds[c] >= 0) {
+            ::close(fds[c]);
+            fds[c] = -1;
+        }
+    }
+    leader = -1;
+    opened = 0;
+}
+
+CounterValues PerfCounters::read() const {
+    CounterValues result;
+    if (leader < 0) {
+        return result;
+    }
+
+    // Number of counters, time enabled, time running, then the values
+    uint64_t buffer[3 + COUNTER_COUNT];
+    ssize_t size = ::read(leader, buffer, sizeof(buffer));
+    if (size < (ssize_t)(3 * sizeof(uint64_t))) {
+        return result;
+    }
+
+    uint64_t n = buffer[0] < (uint64_t)opened ? buffer[0] : (uint64_t)opened;
+    result.enabled = buffer[1];
+    result.running = buffer[2];
+    for (uint64_t i = 0; i < n; i++) {
+        result.values[order[i]] = buffer[3 + i];
+    }
+
+    return result;
+}
+
+#else
+
+bool PerfCounters::open() {
+    error = "no perf_event_open on this system";
+    return false;
+}
+
+void PerfCounters::close() {
+}
+
+CounterValues PerfCounters::read() const {
+    return CounterValues();
+}
+
+#endif
@@ -0,0 +1,95 @@
+#pragma once
+
+// Hardware performance counters of the calling thread, from Linux
+// perf_event_open: cycles, instructions, L1 data and last level cache
+// misses and branch misses. They are opened as one group, read with a
+// single syscall, and count user space only.
+//
+// Where perf_event_open is missing or refused (other systems, the web
+// build, containers, VMs without a PMU, perf_event_paranoid > 2) open()
+// returns false with the reason in error, and the counters read as zero.
+// A counter the CPU lacks is left out of the group on its own.
+
+#include <stdint.h>
+#include <stddef.h>
+
+enum Counter {
+    COUNTER_CYCLES,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_L1D_MISSES,
+    COUNTER_LLC_MISSES,
+    COUNTER_BRANCH_MISSES,
+    COUNTER_COUNT,
+};
+
+const char* counterName(Counter counter);
+
+// Raw counts with the time the group was enabled and the time it was
+// actually on the PMU. Sums of these stay exact under multiplexing, the
+// scaling is done once when the values are read out
+struct CounterValues {
+    uint64_t values[COUNTER_COUNT] = {};
+    // Nanoseconds
+    uint64_t enabled = 0;
+    uint64_t running = 0;
+
+    // False when the group never got to count, the values mean nothing
+    bool available() const {
+        return running > 0;
+    }
+
+    // Count scaled up for the time the group was multiplexed out, 0 when
+    // not available
+    double operator[](Counter counter) const {
+        if (running == 0) {
+            return 0;
+        }
+        double scale = running < enabled ? (double)enabled / (double)running : 1;
+        return (double)values[counter] * scale;
+    }
+
+    void add(const CounterValues& begin, const CounterValues& end) {
+        // Raw counts and times only grow. Going back means a failed read
+        if (end.enabled < begin.enabled || end.running < begin.running) {
+            return;
+        }
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            values[c] += end.values[c] - begin.values[c];
+        }
+        enabled += end.enabled - begin.enabled;
+        running += end.running - begin.running;
+    }
+};
+
+struct PerfCounters {
+    // File descriptor of each counter, -1 if it didn't open. The first
+    // one open leads the group
+    int fds[COUNTER_COUNT] = { -1, -1, -1, -1, -1 };
+    int leader = -1;
+    // Counters in the group, in the order read() returns them
+    Counter order[COUNTER_COUNT] = {};
+    int opened = 0;
+    // Why nothing could be opened
+    const char* error = nullptr;
+
+    PerfCounters() = default;
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool open();
+    void close();
+
+    bool available() const {
+        return leader >= 0;
+    }
+
+    bool has(Counter counter) const {
+        return fds[counter] >= 0;
+    }
+
+    // Raw counts and times since open(), all zero when unavailable. Only
+    // differences of two reads are meaningful
+    CounterValues read() const;
+};
@@ -0,0 +1,65 @@
+#include "phase_timer.h"
+
+#include <math.h>
+
+const char* phaseName(Phase phase) {
+    switch (phase) {
+    case PHASE_SHIP: return "ship";
+    case PHASE_SHOTS: return "shots";
+    case PHASE_SPAWN: return "spawn";
+    case PHASE_GRID: return "grid";
+    case PHASE_ASTEROIDS: return "asteroids";
+    case PHASE_COLLISION: return "collision";
+    case PHASE_REMOVAL: return "removal";
+    case PHASE_INPUT: return "input";
+    case PHASE_DRAW_NET: return "draw net";
+    case PHASE_DRAW_SHIP: return "draw ship";
+    case PHASE_CULL: return "cull";
+    case PHASE_DRAW_FIELD: return "draw field";
+    case PHASE_DRAW_HUD: return "draw hud";
+    case PHASE_PRESENT: return "present";
+    case PHASE_COUNT: break;
+    }
+    return "?";
+}
+
+void FrameTimings::endFrame() {
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        history[next][p] = current[p];
+        current[p] = 0;
+    }
+
+    next = (next + 1) % HISTORY;
+    if (count < HISTORY) {
+        count++;
+    }
+    frames++;
+}
+
+void FrameTimings::reset() {
+    next = 0;
+    count = 0;
+    frames = 0;
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        current[p] = 0;
+        counters[p] = CounterValues();
+    }
+}
+
+PhaseStats FrameTimings::stats(Phase phase) const {
+    if (count == 0) {
+        return PhaseStats{ 0, 0, 0 };
+    }
+
+    PhaseStats s = { INFINITY, 0, 0 };
+
+    for (size_t i = 0; i < count; i++) {
+        float ms = frame(i)[phase];
+        s.min = fminf(s.min, ms);
+        s.max = fmaxf(s.max, ms);
+        s.avg += ms;
+    }
+
+    s.avg /= count;
+    return s;
+}
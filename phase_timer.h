@@ -0,0 +1,129 @@
+#pragma once
+
+// Per-phase timing of the last frames. Code is bracketed with a PhaseTimer
+// for its phase; the milliseconds add up per frame and endFrame() moves
+// them into a ring buffer of HISTORY frames. With perf counters attached,
+// the counts of the thread running each phase are summed as well. While
+// tracing with TRACE_PHASES, phases are also recorded as trace events. A
+// disabled FrameTimings, or none, and no phase tracing make a PhaseTimer
+// cost two branches.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <chrono>
+#include "trace.h"
+#include "perf_counters.h"
+
+enum Phase {
+    // Simulation, inside World::step
+    PHASE_SHIP,
+    PHASE_SHOTS,
+    PHASE_SPAWN,
+    PHASE_GRID,
+    PHASE_ASTEROIDS,
+    PHASE_COLLISION,
+    PHASE_REMOVAL,
+    // Game loop
+    PHASE_INPUT,
+    PHASE_DRAW_NET,
+    PHASE_DRAW_SHIP,
+    PHASE_CULL,
+    PHASE_DRAW_FIELD,
+    PHASE_DRAW_HUD,
+    PHASE_PRESENT,
+    PHASE_COUNT,
+};
+
+const char* phaseName(Phase phase);
+
+struct PhaseStats {
+    float min;
+    float avg;
+    float max;
+};
+
+struct FrameTimings {
+    static const size_t HISTORY = 240;
+
+    bool enabled = false;
+
+    // Milliseconds per phase of the frame being timed
+    float current[PHASE_COUNT] = {};
+
+    // history[(next - 1) % HISTORY] is the last finished frame
+    float history[HISTORY][PHASE_COUNT] = {};
+    size_t next = 0;
+    size_t count = 0;
+
+    // Counted around phases when set and available, owned elsewhere
+    PerfCounters* perf = nullptr;
+    // Summed since the last reset()
+    CounterValues counters[PHASE_COUNT];
+    uint64_t frames = 0;
+
+    void add(Phase phase, float ms) {
+        current[phase] += ms;
+    }
+
+    bool counting() const {
+        return perf && perf->available();
+    }
+
+    // Forgets the history and the counts
+    void reset();
+
+    // Stores the current frame and starts a new one
+    void endFrame();
+
+    // Frame i of the history, 0 the oldest
+    const float* frame(size_t i) const {
+        return history[(next + HISTORY - count + i) % HISTORY];
+    }
+
+    PhaseStats stats(Phase phase) const;
+};
+
+struct PhaseTimer {
+    FrameTimings* timings;
+    Phase phase;
+    bool traced;
+    TraceClock::time_point start;
+    CounterValues startCounts;
+
+    PhaseTimer(FrameTimings* timings, Phase phase) :
+        timings(timings && timings->enabled ? timings : nullptr), phase(phase), traced(tracingPhases()) {
+        if (this->timings && this->timings->counting()) {
+            startCounts = this->timings->perf->read();
+        }
+        if (this->timings || traced) {
+            start = TraceClock::now();
+        }
+    }
+
+    ~PhaseTimer() {
+        stop();
+    }
+
+    // Ends the phase before the end of the scope
+    void stop() {
+        if (!timings && !traced) {
+            return;
+        }
+
+        TraceClock::time_point end = TraceClock::now();
+        if (timings) {
+            std::chrono::duration<float, std::milli> ms = end - start;
+            timings->add(phase, ms.count());
+
+            if (timings->counting()) {
+                timings->counters[phase].add(startCounts, timings->perf->read());
+            }
+        }
+        if (traced) {
+            traceEvent(phaseName(phase), start, end);
+        }
+
+        timings = nullptr;
+        traced = false;
+    }
+};
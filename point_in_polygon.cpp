@@ -0,0 +1,161 @@
+#include "point_in_polygon.h"
+
+#include <assert.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PIP_X86 1
+#include <immintrin.h>
+#endif
+
+void PolygonEdges::set(const Vector2* points, size_t count) {
+    assert(count > 1);
+
+    x1.resize(count);
+    y1.resize(count);
+    y2.resize(count);
+    dx.resize(count);
+    den.resize(count);
+
+    for (size_t i = 0, j = count - 1; i < count; j = i++) {
+        Vector2 p1 = points[i];
+        Vector2 p2 = points[j];
+
+        x1[i] = p1.x;
+        y1[i] = p1.y;
+        y2[i] = p2.y;
+        dx[i] = p2.x - p1.x;
+        den[i] = p2.y - p1.y + 0.000001f;
+    }
+}
+
+static bool insideScalar(Vector2 p, const PolygonEdges& e) {
+    bool inside = false;
+
+    for (size_t k = 0; k < e.size(); k++) {
+        bool intersect = ((e.y1[k] > p.y) != (e.y2[k] > p.y)) &&
+            (p.x < e.dx[k] * (p.y - e.y1[k]) / e.den[k] + e.x1[k]);
+
+        if (intersect) {
+            inside = !inside;
+        }
+    }
+
+    return inside;
+}
+
+static void batchScalar(const Vector2* points, size_t n, const PolygonEdges& e, uint8_t* inside) {
+    for (size_t i = 0; i < n; i++) {
+        inside[i] = insideScalar(points[i], e);
+    }
+}
+
+#ifdef PIP_X86
+
+static size_t batchSSE2(const Vector2* points, size_t n, const PolygonEdges& e, uint8_t* inside) {
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m128 px = _mm_setr_ps(points[i].x, points[i + 1].x, points[i + 2].x, points[i + 3].x);
+        __m128 py = _mm_setr_ps(points[i].y, points[i + 1].y, points[i + 2].y, points[i + 3].y);
+        __m128 acc = _mm_setzero_ps();
+
+        for (size_t k = 0; k < e.size(); k++) {
+            __m128 y1 = _mm_set1_ps(e.y1[k]);
+            __m128 cross = _mm_xor_ps(_mm_cmpgt_ps(y1, py), _mm_cmpgt_ps(_mm_set1_ps(e.y2[k]), py));
+            __m128 t = _mm_mul_ps(_mm_set1_ps(e.dx[k]), _mm_sub_ps(py, y1));
+            t = _mm_add_ps(_mm_div_ps(t, _mm_set1_ps(e.den[k])), _mm_set1_ps(e.x1[k]));
+            acc = _mm_xor_ps(acc, _mm_and_ps(cross, _mm_cmplt_ps(px, t)));
+        }
+
+        int mask = _mm_movemask_ps(acc);
+        for (int l = 0; l < 4; l++) {
+            inside[i + l] = (mask >> l) & 1;
+        }
+    }
+
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t batchAVX2(const Vector2* points, size_t n, const PolygonEdges& e, uint8_t* inside) {
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        // Deinterleave x and y of 8 points
+        __m256 lo = _mm256_loadu_ps(&points[i].x);
+        __m256 hi = _mm256_loadu_ps(&points[i + 4].x);
+        __m256 xs = _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+        __m256 ys = _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+        // Lanes are now in 64-bit block order 0 1 4 5 2 3 6 7, fix it up
+        __m256 px = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(xs), _MM_SHUFFLE(3, 1, 2, 0)));
+        __m256 py = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(ys), _MM_SHUFFLE(3, 1, 2, 0)));
+        __m256 acc = _mm256_setzero_ps();
+
+        for (size_t k = 0; k < e.size(); k++) {
+            __m256 y1 = _mm256_set1_ps(e.y1[k]);
+            __m256 cross = _mm256_xor_ps(_mm256_cmp_ps(y1, py, _CMP_GT_OQ),
+                _mm256_cmp_ps(_mm256_set1_ps(e.y2[k]), py, _CMP_GT_OQ));
+            __m256 t = _mm256_mul_ps(_mm256_set1_ps(e.dx[k]), _mm256_sub_ps(py, y1));
+            t = _mm256_add_ps(_mm256_div_ps(t, _mm256_set1_ps(e.den[k])), _mm256_set1_ps(e.x1[k]));
+            acc = _mm256_xor_ps(acc, _mm256_and_ps(cross, _mm256_cmp_ps(px, t, _CMP_LT_OQ)));
+        }
+
+        int mask = _mm256_movemask_ps(acc);
+        for (int l = 0; l < 8; l++) {
+            inside[i + l] = (mask >> l) & 1;
+        }
+    }
+
+    return i;
+}
+
+#endif
+
+SimdLevel bestSimdLevel() {
+#ifdef PIP_X86
+    static SimdLevel level = []() {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return SimdLevel::AVX2;
+        }
+        if (__builtin_cpu_supports("sse2")) {
+            return SimdLevel::SSE2;
+        }
+        return SimdLevel::SCALAR;
+    }();
+    return level;
+#else
+    return SimdLevel::SCALAR;
+#endif
+}
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::AVX2:
+        return "avx2";
+    case SimdLevel::SSE2:
+        return "sse2";
+    default:
+        return "scalar";
+    }
+}
+
+void CheckAsteroidCollisionBatch(const Vector2* points, size_t n, const PolygonEdges& edges, uint8_t* inside, SimdLevel level) {
+    size_t done = 0;
+
+#ifdef PIP_X86
+    if (level == SimdLevel::AVX2) {
+        done = batchAVX2(points, n, edges, inside);
+    }
+
+    if (level >= SimdLevel::SSE2) {
+        done += batchSSE2(points + done, n - done, edges, inside + done);
+    }
+#endif
+
+    batchScalar(points + done, n - done, edges, inside + done);
+}
+
+void CheckAsteroidCollisionBatch(const Vector2* points, size_t n, const PolygonEdges& edges, uint8_t* inside) {
+    CheckAsteroidCollisionBatch(points, n, edges, inside, bestSimdLevel());
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+// Batch version of CheckAsteroidCollision: tests many points against one
+// polygon. Per-edge terms that do not depend on the point are computed once
+// in PolygonEdges, and the crossing test runs over 8 or 4 points at a time
+// with AVX2 or SSE2 when the CPU has them.
+//
+// Results are bit-for-bit the same as CheckAsteroidCollision: each lane
+// evaluates the same float expression in the same order, including the
+// division, which is exact in IEEE arithmetic for every SIMD width.
+
+#include "include/raymath.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+enum class SimdLevel {
+    SCALAR,
+    SSE2,
+    AVX2,
+};
+
+// Best level supported by the running CPU, detected once
+SimdLevel bestSimdLevel();
+
+const char* simdLevelName(SimdLevel level);
+
+struct PolygonEdges {
+    // Edge k goes from vertex i to vertex j = i - 1 (wrapping), as in
+    // CheckAsteroidCollision
+    std::vector<float> x1;
+    std::vector<float> y1;
+    std::vector<float> y2;
+    std::vector<float> dx;
+    std::vector<float> den;
+
+    void set(const Vector2* points, size_t count);
+
+    size_t size() const {
+        return x1.size();
+    }
+};
+
+// inside[i] is set to 1 if points[i] is inside the polygon, 0 otherwise
+void CheckAsteroidCollisionBatch(const Vector2* points, size_t n, const PolygonEdges& edges, uint8_t* inside);
+
+void CheckAsteroidCollisionBatch(const Vector2* points, size_t n, const PolygonEdges& edges, uint8_t* inside, SimdLevel level);
@@ -0,0 +1,115 @@
+#include "recording.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char RECORDING_MAGIC[4] = { 'A', 'S', 'T', 'R' };
+
+Recording beginRecording(uint64_t seed, float tickRate, const Config& config) {
+    Recording recording;
+    recording.seed = seed;
+    recording.tickRate = tickRate;
+    recording.fieldWidth = config.fieldWidth;
+    recording.fieldHeight = config.fieldHeight;
+    recording.maxAsteroids = config.maxAsteroids;
+    recording.maxShots = config.maxShots;
+    return recording;
+}
+
+void applyRecordingConfig(const Recording& recording, Config& config) {
+    config.fieldWidth = recording.fieldWidth;
+    config.fieldHeight = recording.fieldHeight;
+    config.maxAsteroids = (size_t)recording.maxAsteroids;
+    config.maxShots = (size_t)recording.maxShots;
+}
+
+// Fields are written as they are in memory, every target is little-endian
+template <typename T>
+static bool put(FILE* file, const T& value) {
+    return fwrite(&value, sizeof(T), 1, file) == 1;
+}
+
+template <typename T>
+static bool get(FILE* file, T& value) {
+    return fread(&value, sizeof(T), 1, file) == 1;
+}
+
+bool saveRecording(const char* path, const Recording& recording) {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        fprintf(stderr, "Can't write recording %s\n", path);
+        return false;
+    }
+
+    uint64_t ticks = recording.inputs.size();
+
+    bool ok = fwrite(RECORDING_MAGIC, 1, 4, file) == 4 &&
+        put(file, RECORDING_VERSION) &&
+        put(file, recording.seed) &&
+        put(file, recording.tickRate) &&
+        put(file, recording.fieldWidth) &&
+        put(file, recording.fieldHeight) &&
+        put(file, recording.maxAsteroids) &&
+        put(file, recording.maxShots) &&
+        put(file, ticks) &&
+        fwrite(recording.inputs.data(), 1, ticks, file) == ticks;
+
+    ok = fclose(file) == 0 && ok;
+    if (!ok) {
+        fprintf(stderr, "Failed writing recording %s\n", path);
+    }
+
+    return ok;
+}
+
+bool loadRecording(const char* path, Recording& recording) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Can't open recording %s\n", path);
+        return false;
+    }
+
+    char magic[4];
+    uint32_t version = 0;
+    uint64_t ticks = 0;
+
+    bool ok = fread(magic, 1, 4, file) == 4 && memcmp(magic, RECORDING_MAGIC, 4) == 0 &&
+        get(file, version) && version == RECORDING_VERSION &&
+        get(file, recording.seed) &&
+        get(file, recording.tickRate) &&
+        get(file, recording.fieldWidth) &&
+        get(file, recording.fieldHeight) &&
+        get(file, recording.maxAsteroids) &&
+        get(file, recording.maxShots) &&
+        get(file, ticks);
+
+    // The settings must be ones the options could have given, so the
+    // World is built as in the recorded run
+    if (ok) {
+        Config probe;
+        applyRecordingConfig(recording, probe);
+        ok = validConfig(probe) && recording.tickRate > 0 && isfinite(recording.tickRate);
+    }
+
+    // One byte per tick must follow, checked before sizing the inputs
+    if (ok) {
+        long header = ftell(file);
+        ok = header >= 0 && fseek(file, 0, SEEK_END) == 0;
+        long size = ok ? ftell(file) : -1;
+        ok = ok && size >= header && ticks <= (uint64_t)(size - header) && fseek(file, header, SEEK_SET) == 0;
+    }
+
+    if (ok) {
+        recording.inputs.resize(ticks);
+        ok = fread(recording.inputs.data(), 1, ticks, file) == ticks;
+    }
+
+    fclose(file);
+
+    if (!ok) {
+        fprintf(stderr, "%s is not a version %u recording\n", path, RECORDING_VERSION);
+    }
+
+    return ok;
+}
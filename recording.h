@@ -0,0 +1,50 @@
+#pragma once
+
+// A played game as a file: what the World was created with, the settings
+// that change the simulation, and the input bits of every tick. Replaying
+// it steps a World through exactly the same ticks, so the final
+// World::hash() matches the recorded run.
+//
+// Layout, little-endian:
+//
+//     "ASTR"          magic
+//     u32 version
+//     u64 seed
+//     f32 tick rate
+//     i32 field width, i32 field height
+//     u64 max asteroids, u64 max shots
+//     u64 ticks
+//     u8  input bits, one per tick
+
+#include "config.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+const uint32_t RECORDING_VERSION = 1;
+
+struct Recording {
+    uint64_t seed = 0;
+    float tickRate = 60;
+    int fieldWidth = 0;
+    int fieldHeight = 0;
+    uint64_t maxAsteroids = 0;
+    uint64_t maxShots = 0;
+
+    // Input::bits() of each tick
+    std::vector<uint8_t> inputs;
+};
+
+// Starts an empty recording of a World made with seed and tickRate under
+// config
+Recording beginRecording(uint64_t seed, float tickRate, const Config& config);
+
+// Puts the recorded settings into config, before the World is created
+void applyRecordingConfig(const Recording& recording, Config& config);
+
+bool saveRecording(const char* path, const Recording& recording);
+
+// Returns false with a message on stderr if the file can't be read or is
+// not a recording of this version, or its settings are out of the range
+// the options accept, or it holds fewer ticks than it claims
+bool loadRecording(const char* path, Recording& recording);
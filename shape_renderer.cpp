@@ -0,0 +1,248 @@
+#include "shape_renderer.h"
+
+#include "include/raymath.h"
+#include "include/rlgl.h"
+#include "simulation.h"
+
+#include <string>
+
+// Shape space vertex, relative to the shape center, rotated and moved to
+// the instance
+static const char* instancedVertexShader = R"(#version 330
+in vec2 vertexPosition;
+in vec4 instance;
+uniform mat4 mvp;
+
+void main() {
+    vec2 p = vec2(
+        vertexPosition.x * instance.z - vertexPosition.y * instance.w,
+        vertexPosition.x * instance.w + vertexPosition.y * instance.z);
+    gl_Position = mvp * vec4(instance.xy + p, 0.0, 1.0);
+}
+)";
+
+static const char* instancedFragmentShader = R"(#version 330
+uniform vec4 color;
+out vec4 finalColor;
+
+void main() {
+    finalColor = color;
+}
+)";
+
+// GLSL 100/120, the version line is added at load
+static const char* uniformVertexShader = R"(
+attribute vec2 vertexPosition;
+uniform vec4 instance;
+uniform mat4 mvp;
+
+void main() {
+    vec2 p = vec2(
+        vertexPosition.x * instance.z - vertexPosition.y * instance.w,
+        vertexPosition.x * instance.w + vertexPosition.y * instance.z);
+    gl_Position = mvp * vec4(instance.xy + p, 0.0, 1.0);
+}
+)";
+
+static const char* uniformFragmentShader = R"(
+uniform vec4 color;
+
+void main() {
+    gl_FragColor = color;
+}
+)";
+
+// Two triangles per edge, OUTLINE_WIDTH wide and centered on it, in shape
+// space around the shape center
+static std::vector<float> outlineTriangles(const AsteroidShape& shape) {
+    std::vector<float> out;
+    const std::vector<Vector2>& vertices = shape.vertices;
+
+    for (size_t i = 0, j = vertices.size() - 1; i < vertices.size(); j = i++) {
+        Vector2 a = Vector2Subtract(vertices[j], shape.center);
+        Vector2 b = Vector2Subtract(vertices[i], shape.center);
+        Vector2 d = Vector2Normalize(Vector2Subtract(b, a));
+        Vector2 n = Vector2Scale(Vector2{ -d.y, d.x }, OUTLINE_WIDTH / 2);
+
+        Vector2 quad[6] = {
+            Vector2Add(a, n), Vector2Subtract(a, n), Vector2Subtract(b, n),
+            Vector2Add(a, n), Vector2Subtract(b, n), Vector2Add(b, n),
+        };
+
+        for (Vector2 v : quad) {
+            out.push_back(v.x);
+            out.push_back(v.y);
+        }
+    }
+
+    return out;
+}
+
+// Attribute layout of a mesh, kept by its VAO when there is one
+static void bindMesh(ShapeRenderer& renderer, ShapeMesh& mesh) {
+    rlEnableVertexBuffer(mesh.vbo);
+    rlSetVertexAttribute(renderer.positionLoc, 2, RL_FLOAT, false, 0, 0);
+    rlEnableVertexAttribute(renderer.positionLoc);
+
+    if (renderer.instanced) {
+        rlEnableVertexBuffer(mesh.instanceVbo);
+        rlSetVertexAttribute(renderer.instanceLoc, 4, RL_FLOAT, false, 0, 0);
+        rlEnableVertexAttribute(renderer.instanceLoc);
+        rlSetVertexAttributeDivisor(renderer.instanceLoc, 1);
+    }
+
+    rlDisableVertexBuffer();
+}
+
+bool loadShapeRenderer(ShapeRenderer& renderer, size_t maxInstances) {
+    int version = rlGetVersion();
+
+    if (version == RL_OPENGL_11) {
+        return false;
+    }
+
+    renderer.instanced = version == RL_OPENGL_33 || version == RL_OPENGL_43;
+
+    if (renderer.instanced) {
+        renderer.shader = rlLoadShaderCode(instancedVertexShader, instancedFragmentShader);
+    }
+    else {
+        bool es = version == RL_OPENGL_ES_20 || version == RL_OPENGL_ES_30;
+        std::string vs = std::string(es ? "#version 100\n" : "#version 120\n") + uniformVertexShader;
+        std::string fs = std::string(es ? "#version 100\nprecision mediump float;\n" : "#version 120\n") + uniformFragmentShader;
+        renderer.shader = rlLoadShaderCode(vs.c_str(), fs.c_str());
+    }
+
+    if (renderer.shader == 0) {
+        return false;
+    }
+
+    renderer.mvpLoc = rlGetLocationUniform(renderer.shader, "mvp");
+    renderer.colorLoc = rlGetLocationUniform(renderer.shader, "color");
+    renderer.positionLoc = rlGetLocationAttrib(renderer.shader, "vertexPosition");
+    renderer.instanceLoc = renderer.instanced
+        ? rlGetLocationAttrib(renderer.shader, "instance")
+        : rlGetLocationUniform(renderer.shader, "instance");
+
+    renderer.meshes.resize(asteroidShapes.size());
+
+    for (size_t s = 0; s < asteroidShapes.size(); s++) {
+        ShapeMesh& mesh = renderer.meshes[s];
+        std::vector<float> triangles = outlineTriangles(asteroidShapes[s]);
+
+        mesh.vertexCount = (int)(triangles.size() / 2);
+        mesh.instances.reserve(4 * maxInstances);
+        mesh.vao = rlLoadVertexArray();
+        rlEnableVertexArray(mesh.vao);
+
+        mesh.vbo = rlLoadVertexBuffer(triangles.data(), (int)(triangles.size() * sizeof(float)), false);
+
+        if (renderer.instanced) {
+            mesh.instanceCapacity = 64;
+            mesh.instanceVbo = rlLoadVertexBuffer(NULL, (int)(mesh.instanceCapacity * 4 * sizeof(float)), true);
+        }
+
+        bindMesh(renderer, mesh);
+        rlDisableVertexArray();
+    }
+
+    return true;
+}
+
+void unloadShapeRenderer(ShapeRenderer& renderer) {
+    for (ShapeMesh& mesh : renderer.meshes) {
+        rlUnloadVertexBuffer(mesh.vbo);
+        if (mesh.instanceVbo) {
+            rlUnloadVertexBuffer(mesh.instanceVbo);
+        }
+        rlUnloadVertexArray(mesh.vao);
+    }
+
+    renderer.meshes.clear();
+
+    if (renderer.shader) {
+        rlUnloadShaderProgram(renderer.shader);
+        renderer.shader = 0;
+    }
+}
+
+void clearShapeInstances(ShapeRenderer& renderer) {
+    for (ShapeMesh& mesh : renderer.meshes) {
+        mesh.instances.clear();
+    }
+}
+
+void addShapeInstance(ShapeRenderer& renderer, uint32_t shape, Vector2 center, float cosAngle, float sinAngle) {
+    std::vector<float>& instances = renderer.meshes[shape].instances;
+    instances.push_back(center.x);
+    instances.push_back(center.y);
+    instances.push_back(cosAngle);
+    instances.push_back(sinAngle);
+}
+
+void drawShapes(ShapeRenderer& renderer, Color color) {
+    renderer.drawCalls = 0;
+    renderer.vertices = 0;
+    renderer.uploadBytes = 0;
+
+    rlDrawRenderBatchActive();
+
+    Matrix mvp = MatrixMultiply(rlGetMatrixModelview(), rlGetMatrixProjection());
+    Vector4 c = ColorNormalize(color);
+
+    rlEnableShader(renderer.shader);
+    rlSetUniformMatrix(renderer.mvpLoc, mvp);
+    rlSetUniform(renderer.colorLoc, &c, RL_SHADER_UNIFORM_VEC4, 1);
+    // Edge quads are wound both ways
+    rlDisableBackfaceCulling();
+
+    for (ShapeMesh& mesh : renderer.meshes) {
+        size_t count = mesh.instances.size() / 4;
+        if (count == 0) {
+            continue;
+        }
+
+        bool vao = rlEnableVertexArray(mesh.vao);
+        if (!vao) {
+            bindMesh(renderer, mesh);
+        }
+
+        size_t bytes = mesh.instances.size() * sizeof(float);
+
+        if (renderer.instanced) {
+            if (count > mesh.instanceCapacity) {
+                // Grows by doubling, the VAO has to point at the new buffer
+                while (mesh.instanceCapacity < count) {
+                    mesh.instanceCapacity *= 2;
+                }
+                rlUnloadVertexBuffer(mesh.instanceVbo);
+                mesh.instanceVbo = rlLoadVertexBuffer(NULL, (int)(mesh.instanceCapacity * 4 * sizeof(float)), true);
+                bindMesh(renderer, mesh);
+            }
+
+            rlUpdateVertexBuffer(mesh.instanceVbo, mesh.instances.data(), (int)bytes, 0);
+            rlDrawVertexArrayInstanced(0, mesh.vertexCount, (int)count);
+            renderer.drawCalls++;
+        }
+        else {
+            for (size_t i = 0; i < count; i++) {
+                rlSetUniform(renderer.instanceLoc, &mesh.instances[4 * i], RL_SHADER_UNIFORM_VEC4, 1);
+                rlDrawVertexArray(0, mesh.vertexCount);
+            }
+            renderer.drawCalls += count;
+        }
+
+        renderer.vertices += (uint64_t)mesh.vertexCount * count;
+        renderer.uploadBytes += bytes;
+
+        if (vao) {
+            rlDisableVertexArray();
+        }
+        else {
+            rlDisableVertexAttribute(renderer.positionLoc);
+        }
+    }
+
+    rlEnableBackfaceCulling();
+    rlDisableShader();
+}
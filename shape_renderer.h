@@ -0,0 +1,67 @@
+#pragma once
+
+// Draws asteroid outlines from vertex buffers uploaded once per library
+// shape. Each frame only the instances change: the screen position of the
+// shape center and the rotation, four floats per asteroid.
+//
+// With OpenGL 3.3 each shape is one instanced draw. OpenGL 2.1 and ES
+// (the web build) have no instancing in rlgl, there every asteroid is a
+// draw of the same buffer with the instance passed as a uniform.
+
+#include "include/raylib.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+// Outline width in pixels, edges are drawn as thin quads
+const float OUTLINE_WIDTH = 1;
+
+struct ShapeMesh {
+    unsigned int vao = 0;
+    unsigned int vbo = 0;
+    // Per instance attribute buffer, only with instancing
+    unsigned int instanceVbo = 0;
+    size_t instanceCapacity = 0;
+    int vertexCount = 0;
+
+    // x, y, cos, sin of each instance this frame
+    std::vector<float> instances;
+};
+
+struct ShapeRenderer {
+    unsigned int shader = 0;
+    bool instanced = false;
+    int mvpLoc = -1;
+    int colorLoc = -1;
+    // Attribute with instancing, uniform without
+    int instanceLoc = -1;
+    int positionLoc = -1;
+
+    // Indexed like asteroidShapes
+    std::vector<ShapeMesh> meshes;
+
+    // Of the last drawShapes()
+    uint64_t drawCalls = 0;
+    uint64_t vertices = 0;
+    uint64_t uploadBytes = 0;
+
+    bool loaded() const {
+        return shader != 0;
+    }
+};
+
+// Builds the shader and one buffer per shape in asteroidShapes, with room
+// for maxInstances instances of each. Returns false, leaving the renderer
+// unloaded, when the GL version has no shaders
+bool loadShapeRenderer(ShapeRenderer& renderer, size_t maxInstances);
+
+void unloadShapeRenderer(ShapeRenderer& renderer);
+
+void clearShapeInstances(ShapeRenderer& renderer);
+
+// center is the screen position of the shape center
+void addShapeInstance(ShapeRenderer& renderer, uint32_t shape, Vector2 center, float cosAngle, float sinAngle);
+
+// Draws every instance added since the last clear. Flushes rlgl's batch
+// first so the outlines keep their place in the draw order
+void drawShapes(ShapeRenderer& renderer, Color color);
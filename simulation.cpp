@@ -0,0 +1,721 @@
+#include "simulation.h"
+
+Vector2 centerPoint(const std::vector<Vector2>& vertices) {
+    float x = 0;
+    float y = 0;
+    float a = 0;
+
+    size_t n = vertices.size();
+
+    for (size_t i = 0; i < n; i++) {
+        float x1 = vertices[i].x;
+        float y1 = vertices[i].y;
+
+        float x2 = vertices[(i + 1) % n].x;
+        float y2 = vertices[(i + 1) % n].y;
+
+        a += x1 * y2 - x2 * y1;
+
+        float cross = (x1 * y2 - x2 * y1);
+        x += (x1 + x2) * cross;
+        y += (y1 + y2) * cross;
+    }
+
+    x /= (3 * a);
+    y /= (3 * a);
+
+    return Vector2{ x, y };
+}
+
+void Shots::reserve(size_t n) {
+    x.reserve(n);
+    y.reserve(n);
+    dirX.reserve(n);
+    dirY.reserve(n);
+    prevX.reserve(n);
+    prevY.reserve(n);
+    dead.reserve(n);
+}
+
+void Shots::push_back(const Shot& shot) {
+    x.push_back(shot.pos.x);
+    y.push_back(shot.pos.y);
+    dirX.push_back(shot.dir.x);
+    dirY.push_back(shot.dir.y);
+    prevX.push_back(shot.pos.x);
+    prevY.push_back(shot.pos.y);
+    dead.push_back(0);
+}
+
+// Stable in-place compaction of one field array, returns the new size
+template <typename T>
+static size_t compactField(AlignedVector<T>& field, const uint8_t* dead) {
+    size_t n = field.size();
+    size_t out = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        field[out] = field[i];
+        out += !dead[i];
+    }
+
+    field.resize(out);
+    return out;
+}
+
+size_t Shots::removeDead() {
+    size_t n = size();
+    const uint8_t* marks = dead.data();
+
+    compactField(x, marks);
+    compactField(y, marks);
+    compactField(dirX, marks);
+    compactField(dirY, marks);
+    compactField(prevX, marks);
+    compactField(prevY, marks);
+
+    size_t alive = x.size();
+    dead.assign(alive, 0);
+
+    return n - alive;
+}
+
+void Shots::move(float scale) {
+    size_t n = size();
+    float* __restrict px = x.data();
+    float* __restrict py = y.data();
+    float* __restrict lastX = prevX.data();
+    float* __restrict lastY = prevY.data();
+    const float* __restrict dx = dirX.data();
+    const float* __restrict dy = dirY.data();
+    float speed = SHOT_SPEED * scale;
+
+    for (size_t i = 0; i < n; i++) {
+        lastX[i] = px[i];
+        lastY[i] = py[i];
+        px[i] += dx[i] * speed;
+        py[i] += dy[i] * speed;
+    }
+}
+
+Asteroid Asteroids::get(size_t i) const {
+    Asteroid asteroid;
+    asteroid.pos = Vector2{ x[i], y[i] };
+    asteroid.dir = Vector2{ dirX[i], dirY[i] };
+    asteroid.angle = angle[i];
+    asteroid.angularVelocity = angularVelocity[i];
+    asteroid.shape = shape[i];
+    asteroid.cosAngle = cosAngle[i];
+    asteroid.sinAngle = sinAngle[i];
+    asteroid.updateBounds();
+    return asteroid;
+}
+
+Asteroid Asteroids::interpolated(size_t i, float alpha) const {
+    Asteroid asteroid = get(i);
+
+    asteroid.pos = Vector2Lerp(Vector2{ prevX[i], prevY[i] }, asteroid.pos, alpha);
+
+    // Shortest way round when the angle wrapped during the tick
+    float delta = angle[i] - prevAngle[i];
+    if (delta > PI) {
+        delta -= 2 * PI;
+    }
+    else if (delta < -PI) {
+        delta += 2 * PI;
+    }
+
+    asteroid.angle = prevAngle[i] + delta * alpha;
+    asteroid.cosAngle = cosf(asteroid.angle);
+    asteroid.sinAngle = sinf(asteroid.angle);
+    asteroid.updateBounds();
+
+    return asteroid;
+}
+
+void Asteroids::reserve(size_t n) {
+    x.reserve(n);
+    y.reserve(n);
+    dirX.reserve(n);
+    dirY.reserve(n);
+    angle.reserve(n);
+    angularVelocity.reserve(n);
+    cosAngle.reserve(n);
+    sinAngle.reserve(n);
+    shape.reserve(n);
+    prevX.reserve(n);
+    prevY.reserve(n);
+    prevAngle.reserve(n);
+    dead.reserve(n);
+}
+
+void Asteroids::push_back(const Asteroid& asteroid) {
+    x.push_back(asteroid.pos.x);
+    y.push_back(asteroid.pos.y);
+    dirX.push_back(asteroid.dir.x);
+    dirY.push_back(asteroid.dir.y);
+    angle.push_back(asteroid.angle);
+    angularVelocity.push_back(asteroid.angularVelocity);
+    cosAngle.push_back(asteroid.cosAngle);
+    sinAngle.push_back(asteroid.sinAngle);
+    shape.push_back(asteroid.shape);
+    prevX.push_back(asteroid.pos.x);
+    prevY.push_back(asteroid.pos.y);
+    prevAngle.push_back(asteroid.angle);
+    dead.push_back(0);
+}
+
+size_t Asteroids::removeDead() {
+    size_t n = size();
+    const uint8_t* marks = dead.data();
+
+    compactField(x, marks);
+    compactField(y, marks);
+    compactField(dirX, marks);
+    compactField(dirY, marks);
+    compactField(angle, marks);
+    compactField(angularVelocity, marks);
+    compactField(cosAngle, marks);
+    compactField(sinAngle, marks);
+    compactField(shape, marks);
+    compactField(prevX, marks);
+    compactField(prevY, marks);
+    compactField(prevAngle, marks);
+
+    size_t alive = x.size();
+    dead.assign(alive, 0);
+
+    return n - alive;
+}
+
+void Asteroids::rotate(float scale, size_t begin, size_t end) {
+    size_t n = end - begin;
+    float* __restrict a = angle.data() + begin;
+    float* __restrict last = prevAngle.data() + begin;
+    const float* __restrict w = angularVelocity.data() + begin;
+
+    for (size_t i = 0; i < n; i++) {
+        // Wrap into [-PI, PI]. Both tests look at the unwrapped angle so
+        // they become selects and the loop vectorizes
+        last[i] = a[i];
+        float next = a[i] + w[i] * scale;
+        float wrap = next > PI ? -2 * PI : 0.0f;
+        wrap = next < -PI ? 2 * PI : wrap;
+        a[i] = next + wrap;
+    }
+}
+
+void Asteroids::move(float scale, size_t begin, size_t end) {
+    size_t n = end - begin;
+    float* __restrict px = x.data() + begin;
+    float* __restrict py = y.data() + begin;
+    float* __restrict lastX = prevX.data() + begin;
+    float* __restrict lastY = prevY.data() + begin;
+    const float* __restrict dx = dirX.data() + begin;
+    const float* __restrict dy = dirY.data() + begin;
+
+    for (size_t i = 0; i < n; i++) {
+        lastX[i] = px[i];
+        lastY[i] = py[i];
+        px[i] += dx[i] * scale;
+        py[i] += dy[i] * scale;
+    }
+}
+
+void addShot(Shots& shots, Ship& ship) {
+    if (shots.size() < config.maxShots) {
+        Shot shot = {
+            .pos = ship.pos,
+            .dir = Vector2Scale(Vector2Normalize(ship.dir), 1),
+        };
+
+        shots.push_back(shot);
+    }
+}
+
+void moveShots(Shots& shots, float scale) {
+    for (size_t i = 0; i < shots.size(); i++) {
+        if (!shots.isShotOnField(i)) {
+            shots.kill(i);
+        }
+    }
+
+    // Shots off the field move too, they are removed right after
+    shots.move(scale);
+
+    shots.removeDead();
+}
+
+bool CheckAsteroidCollision(Vector2 p, std::vector<Vector2>& points) {
+    return CheckAsteroidCollision(p, points.data(), points.size());
+}
+
+bool CheckAsteroidCollision(Vector2 p, const Vector2* points, size_t count) {
+    assert(count > 1);
+
+    bool inside = false;
+
+    for (size_t i = 0, j = count - 1; i < count; j = i++) {
+        Vector2 p1 = points[i];
+        Vector2 p2 = points[j];
+
+        // Check if edge (i,j) crosses a horizontal ray to the right of the point
+        bool intersect = ((p1.y > p.y) != (p2.y > p.y)) &&
+            (p.x < (p2.x - p1.x) * (p.y - p1.y) / (p2.y - p1.y + 0.000001f) + p1.x);
+
+        if (intersect) {
+            inside = !inside;
+        }
+    }
+
+    return inside;
+}
+
+std::vector<std::vector<Vector2>> asteroidsLibarary = {
+    std::vector<Vector2> {
+        Vector2{ 51, 78 },
+        Vector2{ -15, 99 },
+        Vector2{ -20, 0 },
+        Vector2{ 0, -40 },
+        Vector2{ 82, -48 },
+        Vector2{ 126, 12 },
+    }
+};
+
+float shapeRadius(const std::vector<Vector2>& vertices, Vector2 center) {
+    float radius = 0;
+
+    for (Vector2 v : vertices) {
+        radius = fmaxf(radius, Vector2Distance(v, center));
+    }
+
+    return radius;
+}
+
+// Room for a tick's shot positions and ids at the shot limit, so the
+// arena doesn't grow after the first ticks
+static size_t arenaCapacity() {
+    size_t perShot = sizeof(Vector2) + sizeof(uint32_t);
+    size_t needed = 2 * config.maxShots * perShot;
+    return needed > 64 * 1024 ? needed : 64 * 1024;
+}
+
+World::World(uint64_t seed, float rate) : random(seed), arena(arenaCapacity()) {
+    tickRate = rate;
+    tickScale = BASE_TICK_RATE / rate;
+
+    // Both only grow up to their limits, reaching them later must not
+    // allocate
+    shots.reserve(config.maxShots);
+    asteroids.reserve(config.maxAsteroids);
+
+    float radius = 0;
+
+    for (AsteroidShape& shape : asteroidShapes) {
+        radius = fmaxf(radius, shape.radius);
+    }
+
+    // Shots are bucketed, so every shot inside an asteroid's bounding
+    // circle is in the cell of its center or a neighbour
+    grid.reset(radius, config.maxShots);
+
+    // Chunks go by asteroid position, which can be off the shape by the
+    // length of its center plus the radius
+    float reach = 0;
+
+    for (AsteroidShape& shape : asteroidShapes) {
+        reach = fmaxf(reach, Vector2Length(shape.center) + shape.radius);
+    }
+
+    chunks.reset(config.fieldWidth, config.fieldHeight, fmaxf(reach, config.chunkSize));
+}
+
+static std::vector<AsteroidShape> buildAsteroidShapes(std::vector<std::vector<Vector2>>& library) {
+    std::vector<AsteroidShape> shapes;
+
+    for (std::vector<Vector2>& vertices : library) {
+        AsteroidShape shape;
+        shape.vertices = vertices;
+        shape.center = centerPoint(vertices);
+        shape.radius = shapeRadius(vertices, shape.center) + boundsSlack;
+        shape.edges.set(vertices.data(), vertices.size());
+        shapes.push_back(shape);
+    }
+
+    return shapes;
+}
+
+std::vector<AsteroidShape> asteroidShapes = buildAsteroidShapes(asteroidsLibarary);
+
+Asteroid getRandAsteroid(Random& random) {
+    int i = random.value(0, asteroidsLibarary.size() - 1);
+
+    int side = random.value(0, 3);
+
+    Vector2 pos;
+    Vector2 dir;
+    Asteroid asteroid;
+
+    if (side == 0) { // top
+        pos = Vector2{ (float)random.value(0, config.fieldWidth), 0 };
+        dir = Vector2{ (float)random.value(1, 3), (float)random.value(1, 3) };
+    }
+    else if (side == 1) { // right
+        pos = Vector2{ 0, (float)random.value(0, config.fieldHeight) };
+        dir = Vector2{ (float)random.value(1, 3), (float)random.value(-3, 3) };
+    }
+    else if (side == 2) { // bottom
+        pos = Vector2{ (float)random.value(0, config.fieldWidth), (float)config.fieldHeight };
+        dir = Vector2{ (float)random.value(-3, 3), (float)random.value(-3, -1) };
+    }
+    else { // left
+        pos = Vector2{ 0, (float)random.value(0, config.fieldHeight) };
+        dir = Vector2{ (float)random.value(1, 3), (float)random.value(-3, 3) };
+    }
+
+    return Asteroid(pos, dir, i);
+}
+
+void World::collideRange(size_t begin, size_t end, const std::array<Vector2, 3>& shipVertices,
+    const Vector2* shotPositions, CollisionScratch& scratch) {
+    std::vector<Vector2>& points = scratch.points;
+
+    // Tests the points that passed the bounding box in one batch,
+    // mapped into shape space so the shape's edges can be reused
+    auto collidesAny = [&](Asteroid& asteroid) {
+        if (points.empty()) {
+            return;
+        }
+
+        for (Vector2& p : points) {
+            p = asteroid.toLocal(p);
+        }
+
+        CheckAsteroidCollisionBatch(points.data(), points.size(), asteroid.getShape().edges, scratch.inside.data());
+    };
+
+    const float* x = asteroids.x.data();
+    const float* y = asteroids.y.data();
+    bool lod = !bruteForceCollisions;
+
+    for (size_t i = begin; i < end; i++) {
+        // A position on the field keeps an asteroid alive, and away from
+        // the ship and the shots there is nothing to hit
+        bool onField = 0 <= x[i] && x[i] <= config.fieldWidth && 0 <= y[i] && y[i] <= config.fieldHeight;
+        if (lod && onField && !chunks.isDetailed(x[i], y[i])) {
+            continue;
+        }
+
+        asteroids.refreshRotation(i);
+        scratch.detailed++;
+
+        Asteroid asteroid = asteroids.get(i);
+
+        // is on field?
+        if (!asteroid.isOnField()) {
+            asteroids.kill(i);
+            continue;
+        }
+
+        // check ship collision
+
+        points.clear();
+        for (Vector2 v : shipVertices) {
+            if (asteroid.bounds.contains(v)) {
+                points.push_back(v);
+            }
+        }
+
+        collidesAny(asteroid);
+
+        bool shipHit = false;
+        for (size_t m = 0; m < points.size(); m++) {
+            shipHit = shipHit || scratch.inside[m];
+        }
+
+        if (shipHit) {
+            asteroids.kill(i);
+            continue;
+        }
+
+        if (bruteForceCollisions) {
+            std::vector<Vector2>& vertices = asteroidShapes[asteroid.shape].vertices;
+
+            for (size_t j = 0; j < shots.size(); j++) {
+                if (CheckAsteroidCollision(asteroid.toLocal(shotPositions[j]), vertices)) {
+                    asteroids.kill(i);
+                    scratch.hits.push_back(Hit{ (uint32_t)i, (uint32_t)j });
+                }
+            }
+            continue;
+        }
+
+        if (shots.empty()) {
+            continue;
+        }
+
+        // Shots near the asteroid go through the batch test together
+        points.clear();
+        scratch.shots.clear();
+        grid.query(asteroid.center(), [&](uint32_t j) {
+            if (asteroid.bounds.contains(shotPositions[j])) {
+                points.push_back(shotPositions[j]);
+                scratch.shots.push_back(j);
+            }
+        });
+
+        collidesAny(asteroid);
+
+        for (size_t m = 0; m < scratch.shots.size(); m++) {
+            if (scratch.inside[m]) {
+                asteroids.kill(i);
+                scratch.hits.push_back(Hit{ (uint32_t)i, scratch.shots[m] });
+            }
+        }
+    }
+}
+
+void World::step(const Input& input) {
+    {
+        PhaseTimer timer(timings, PHASE_SHIP);
+
+        ship.is_engine_working = false;
+        ship.prevPos = ship.pos;
+        ship.prevDir = ship.dir;
+
+        if (input.fire) {
+            addShot(shots, ship);
+        }
+
+        if (input.rotateLeft) {
+            ship.rotate(LEFT, tickScale);
+        }
+
+        if (input.rotateRight) {
+            ship.rotate(RIGHT, tickScale);
+        }
+
+        if (input.forward) {
+            ship.move(FORWARD, tickScale);
+        }
+
+        if (input.backward) {
+            ship.move(BACKWARD, tickScale);
+        }
+
+        ship.slowdown(tickScale);
+    }
+
+    {
+        PhaseTimer timer(timings, PHASE_SHOTS);
+        moveShots(shots, tickScale);
+    }
+
+    {
+        PhaseTimer timer(timings, PHASE_SPAWN);
+
+        // Refills half of what is missing (rounded up) each tick
+        size_t missing = config.maxAsteroids > asteroids.size() ? config.maxAsteroids - asteroids.size() : 0;
+        for (size_t i = 0; i < (missing + 1) / 2; i++) {
+            asteroids.push_back(getRandAsteroid(random));
+        }
+    }
+
+    {
+        PhaseTimer gridTimer(timings, PHASE_GRID);
+
+        // Shot positions and the grid are built first, the asteroid pass
+        // only reads them
+        std::pmr::vector<Vector2> shotPositions(shots.size(), &arena);
+        std::pmr::vector<uint32_t> shotIds(shots.size(), &arena);
+        for (uint32_t j = 0; j < shots.size(); j++) {
+            shotPositions[j] = shots.pos(j);
+            shotIds[j] = j;
+        }
+
+        if (!bruteForceCollisions && !shots.empty()) {
+            grid.build(shotPositions.data(), shotIds.data(), shots.size());
+        }
+
+        auto [v1, v2, v3] = ship.getVertices();
+        std::array<Vector2, 3> shipVertices = {
+            Vector2Add(ship.pos, v1),
+            Vector2Add(ship.pos, v2),
+            Vector2Add(ship.pos, v3),
+        };
+
+        // Sized for the shot limit up front, not for the most shots so far
+        size_t maxBatch = config.maxShots > 3 ? config.maxShots : 3;
+
+        scratch.resize(jobs ? jobs->size() : 1);
+        for (CollisionScratch& s : scratch) {
+            s.points.reserve(maxBatch);
+            s.shots.reserve(maxBatch);
+            s.inside.resize(maxBatch);
+            // A shot rarely hits more than one asteroid, so this holds a
+            // tick's hits without growing the first time one is found
+            s.hits.reserve(config.maxShots);
+            s.hits.clear();
+            s.detailed = 0;
+            s.updateMs = 0;
+            s.collisionMs = 0;
+        }
+
+        // The view, with a chunk of margin for asteroids reaching into it,
+        // and every chunk a shot could hit something in
+        chunks.clear();
+        Vector2 margin = Vector2AddValue(viewHalfSize, chunks.chunkSize);
+        chunks.markRect(Vector2Subtract(ship.pos, margin), Vector2Add(ship.pos, margin));
+        for (Vector2 p : shotPositions) {
+            chunks.markAround(p);
+        }
+
+        gridTimer.stop();
+
+        bool timed = timings && timings->enabled;
+        // Chunks are traced on the thread that ran them
+        bool traced = tracingPhases();
+        using Clock = TraceClock;
+        using Ms = std::chrono::duration<float, std::milli>;
+
+        // Counters are of the calling thread, so only its chunks are
+        // counted. Worker 0 is always the calling thread
+        bool counted = timed && timings->counting();
+
+        auto pass = [&](size_t begin, size_t end, unsigned worker) {
+            bool count = counted && worker == 0;
+            CounterValues startCounts;
+            CounterValues movedCounts;
+
+            Clock::time_point start;
+            if (timed || traced) {
+                start = Clock::now();
+            }
+            if (count) {
+                startCounts = timings->perf->read();
+            }
+
+            asteroids.rotate(tickScale, begin, end);
+            asteroids.move(tickScale, begin, end);
+
+            Clock::time_point moved;
+            if (timed || traced) {
+                moved = Clock::now();
+            }
+            if (count) {
+                movedCounts = timings->perf->read();
+                timings->counters[PHASE_ASTEROIDS].add(startCounts, movedCounts);
+            }
+
+            collideRange(begin, end, shipVertices, shotPositions.data(), scratch[worker]);
+
+            if (count) {
+                timings->counters[PHASE_COLLISION].add(movedCounts, timings->perf->read());
+            }
+
+            if (timed || traced) {
+                Clock::time_point collided = Clock::now();
+                if (timed) {
+                    scratch[worker].updateMs += Ms(moved - start).count();
+                    scratch[worker].collisionMs += Ms(collided - moved).count();
+                }
+                if (traced) {
+                    traceEvent("asteroid chunk", start, moved);
+                    traceEvent("collision chunk", moved, collided);
+                }
+            }
+        };
+
+        Clock::time_point passStart;
+        if (timed || traced) {
+            passStart = Clock::now();
+        }
+
+        if (jobs) {
+            jobs->parallelFor(asteroids.size(), ASTEROID_CHUNK, pass);
+        }
+        else {
+            pass(0, asteroids.size(), 0);
+        }
+
+        if (traced) {
+            traceEvent("asteroid pass", passStart, Clock::now());
+        }
+
+        if (timed) {
+            // Workers overlap, so the wall time of the pass is split in the
+            // ratio of the time they spent in each part
+            float update = 0;
+            float collision = 0;
+            for (CollisionScratch& s : scratch) {
+                update += s.updateMs;
+                collision += s.collisionMs;
+            }
+
+            float wall = Ms(Clock::now() - passStart).count();
+            float share = update + collision > 0 ? update / (update + collision) : 0;
+            timings->add(PHASE_ASTEROIDS, wall * share);
+            timings->add(PHASE_COLLISION, wall * (1 - share));
+        }
+
+        PhaseTimer removalTimer(timings, PHASE_REMOVAL);
+
+        // Every (asteroid, shot) hit scores, like the original all-pairs
+        // loop. Kill marks and the sum do not depend on which worker found
+        // a hit, so the result is the same as a serial run
+        detailedAsteroids = 0;
+        for (CollisionScratch& s : scratch) {
+            for (Hit hit : s.hits) {
+                shots.kill(hit.shot);
+                score++;
+            }
+            detailedAsteroids += s.detailed;
+        }
+
+        asteroids.removeDead();
+        shots.removeDead();
+    }
+
+    arena.reset();
+
+    tick++;
+}
+
+static uint64_t hashBytes(uint64_t h, const void* data, size_t size) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i++) {
+        h = (h ^ bytes[i]) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+template <typename T>
+static uint64_t hashField(uint64_t h, const AlignedVector<T>& field) {
+    return hashBytes(h, field.data(), field.size() * sizeof(T));
+}
+
+uint64_t World::hash() const {
+    uint64_t h = 0xcbf29ce484222325ULL;
+
+    h = hashBytes(h, &score, sizeof(score));
+    h = hashBytes(h, &tick, sizeof(tick));
+    h = hashBytes(h, &random.state, sizeof(random.state));
+
+    h = hashBytes(h, &ship.pos, sizeof(ship.pos));
+    h = hashBytes(h, &ship.dir, sizeof(ship.dir));
+    h = hashBytes(h, &ship.speed, sizeof(ship.speed));
+
+    h = hashField(h, shots.x);
+    h = hashField(h, shots.y);
+    h = hashField(h, shots.dirX);
+    h = hashField(h, shots.dirY);
+
+    h = hashField(h, asteroids.x);
+    h = hashField(h, asteroids.y);
+    h = hashField(h, asteroids.dirX);
+    h = hashField(h, asteroids.dirY);
+    h = hashField(h, asteroids.angle);
+    h = hashField(h, asteroids.angularVelocity);
+    h = hashField(h, asteroids.shape);
+
+    return h;
+}
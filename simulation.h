@@ -0,0 +1,537 @@
+#pragma once
+
+// Game simulation without any windowing code. Only the header-only raymath
+// is used here, so this part builds and runs without raylib.
+
+#include "include/raymath.h"
+#include "config.h"
+#include "aligned_vector.h"
+#include "spatial_grid.h"
+#include "chunk_map.h"
+#include "point_in_polygon.h"
+#include "frame_arena.h"
+#include "job_system.h"
+#include "phase_timer.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <array>
+#include <chrono>
+
+const float ROTATION_SPEED = PI / 32;
+const float MAX_SPEED = 6;
+
+const float rotationAngle = 0.05;
+
+enum turn {
+    LEFT,
+    RIGHT,
+};
+
+enum move {
+    FORWARD,
+    BACKWARD,
+};
+
+// Speeds and increments below are per tick at BASE_TICK_RATE. At other
+// tick rates they are multiplied by scale = BASE_TICK_RATE / tick rate,
+// which is exactly 1 at the base rate.
+const float BASE_TICK_RATE = 60;
+
+struct Ship {
+    Vector2 dir = (Vector2){ 1, 0 };;
+    Vector2 pos = (Vector2){ config.fieldWidth / 2.0f, config.fieldHeight / 2.0f };
+    float speed = 0;
+    bool is_engine_working = false;
+
+    // State before the last tick, for render interpolation
+    Vector2 prevDir = dir;
+    Vector2 prevPos = pos;
+
+    void rotate(enum turn t, float scale = 1) {
+        dir = Vector2Rotate(dir, (t == LEFT ? -ROTATION_SPEED : ROTATION_SPEED) * scale);
+    }
+
+    void move(enum move m, float scale = 1) {
+        if (m == FORWARD) {
+            if (speed < MAX_SPEED) {
+                speed += 0.2 * scale;
+            }
+            is_engine_working = true;
+        }
+        else if (m == BACKWARD) {
+            if (speed > -MAX_SPEED) {
+                speed -= 0.2 * scale;
+            }
+            is_engine_working = true;
+        }
+        else {
+            assert(false && "Unexpected move type");
+        }
+    }
+
+    void slowdown(float scale = 1) {
+        if (speed != 0) {
+            Vector2 new_pos = Vector2Add(pos, Vector2Scale(dir, speed * scale));
+
+            if (0 <= new_pos.x && new_pos.x < config.fieldWidth) {
+                pos.x = new_pos.x;
+            }
+
+            if (0 <= new_pos.y && new_pos.y < config.fieldHeight) {
+                pos.y = new_pos.y;
+            }
+
+            if (speed > 0) {
+                if (speed > 0.07 * scale) {
+                    speed -= 0.07 * scale;
+                }
+                else {
+                    speed = 0.0;
+                }
+            }
+
+            if (speed < 0) {
+                if (speed < 0.07 * scale) {
+                    speed += 0.07 * scale;
+                }
+                else {
+                    speed = 0.0;
+                }
+            }
+        }
+    }
+
+    // Ship between the previous and the current tick, alpha in [0, 1]
+    Ship interpolated(float alpha) const {
+        Ship view = *this;
+        view.pos = Vector2Lerp(prevPos, pos, alpha);
+        view.dir = Vector2Normalize(Vector2Lerp(prevDir, dir, alpha));
+        return view;
+    }
+
+    std::array<Vector2, 3> getVertices() {
+        std::array<Vector2, 3> vs;
+        vs[0] = Vector2Scale(dir, 15);
+
+        float l = (3 * PI) / 4;
+        vs[1] = Vector2Rotate(vs[0], l);
+
+        float r = (5 * PI) / 4;
+        vs[2] = Vector2Rotate(vs[0], r);
+
+        return vs;
+    }
+};
+
+const float SHOT_SPEED = 10;
+
+struct Shot {
+    Vector2 pos;
+    Vector2 dir;
+};
+
+// Shots stored as one array per field
+struct Shots {
+    AlignedVector<float> x;
+    AlignedVector<float> y;
+    AlignedVector<float> dirX;
+    AlignedVector<float> dirY;
+    // Position before the last tick, for render interpolation
+    AlignedVector<float> prevX;
+    AlignedVector<float> prevY;
+    // Kill marks, cleared by removeDead()
+    AlignedVector<uint8_t> dead;
+
+    size_t size() const {
+        return x.size();
+    }
+
+    bool empty() const {
+        return x.empty();
+    }
+
+    Vector2 pos(size_t i) const {
+        return Vector2{ x[i], y[i] };
+    }
+
+    // Position between the previous and the current tick
+    Vector2 interpolatedPos(size_t i, float alpha) const {
+        return Vector2Lerp(Vector2{ prevX[i], prevY[i] }, pos(i), alpha);
+    }
+
+    Shot get(size_t i) const {
+        return Shot{ .pos = pos(i), .dir = Vector2{ dirX[i], dirY[i] } };
+    }
+
+    void reserve(size_t n);
+    void push_back(const Shot& shot);
+
+    // Marking twice is harmless, the shot is removed once
+    void kill(size_t i) {
+        dead[i] = 1;
+    }
+
+    // Drops killed shots in one pass, keeping the order of the rest.
+    // Returns how many were removed
+    size_t removeDead();
+
+    bool isShotOnField(size_t i) const {
+        return 0 <= x[i] && x[i] <= config.fieldWidth && 0 <= y[i] && y[i] <= config.fieldHeight;
+    }
+
+    // Advances every shot by its direction times SHOT_SPEED
+    void move(float scale = 1);
+};
+
+Vector2 centerPoint(const std::vector<Vector2>& vertices);
+
+// Largest distance from center to any of the vertices
+float shapeRadius(const std::vector<Vector2>& vertices, Vector2 center);
+
+// Slack added to bounding radii for rounding in the shape transform
+const float boundsSlack = 1;
+
+struct Bounds {
+    float minX;
+    float minY;
+    float maxX;
+    float maxY;
+
+    bool contains(Vector2 p) const {
+        return minX <= p.x && p.x <= maxX && minY <= p.y && p.y <= maxY;
+    }
+
+    bool overlaps(const Bounds& other) const {
+        return minX <= other.maxX && other.minX <= maxX && minY <= other.maxY && other.minY <= maxY;
+    }
+};
+
+// Library shape shared by every asteroid that uses it. Vertices are
+// relative to the asteroid position, and rotation is around center.
+struct AsteroidShape {
+    std::vector<Vector2> vertices;
+    Vector2 center;
+    // Bounding circle around center
+    float radius;
+    // Crossing test terms of vertices, for points in shape space
+    PolygonEdges edges;
+};
+
+extern std::vector<std::vector<Vector2>> asteroidsLibarary;
+
+// Built once from asteroidsLibarary, indexed by Asteroid::shape
+extern std::vector<AsteroidShape> asteroidShapes;
+
+struct Asteroid {
+    Vector2 pos;
+    Vector2 dir;
+    float angle = 0;
+    float angularVelocity = rotationAngle;
+    uint32_t shape = 0;
+    // Rotation matrix for angle
+    float cosAngle = 1;
+    float sinAngle = 0;
+    // Box around the bounding circle at the current position
+    Bounds bounds;
+
+    Asteroid() {}
+
+    Asteroid(Vector2 pos, Vector2 dir, uint32_t shape) : pos(pos), dir(dir), shape(shape) {
+        updateBounds();
+    }
+
+    const AsteroidShape& getShape() const {
+        return asteroidShapes[shape];
+    }
+
+    Vector2 center() const {
+        return Vector2Add(pos, getShape().center);
+    }
+
+    void updateBounds() {
+        Vector2 c = center();
+        float radius = getShape().radius;
+        bounds = Bounds{ c.x - radius, c.y - radius, c.x + radius, c.y + radius };
+    }
+
+    // Shape space vertex to field space
+    Vector2 toField(Vector2 v) const {
+        Vector2 c = getShape().center;
+        float x = v.x - c.x;
+        float y = v.y - c.y;
+        return Vector2{
+            pos.x + c.x + x * cosAngle - y * sinAngle,
+            pos.y + c.y + x * sinAngle + y * cosAngle,
+        };
+    }
+
+    // Field space point to shape space, the inverse of toField
+    Vector2 toLocal(Vector2 p) const {
+        Vector2 c = getShape().center;
+        float x = p.x - pos.x - c.x;
+        float y = p.y - pos.y - c.y;
+        return Vector2{
+            c.x + x * cosAngle + y * sinAngle,
+            c.y - x * sinAngle + y * cosAngle,
+        };
+    }
+
+    bool isOnField() {
+        if (0 <= pos.x && pos.x <= config.fieldWidth && 0 <= pos.y && pos.y <= config.fieldHeight) {
+            return true;
+        }
+
+        // No vertex can be on the field if the bounding circle misses it
+        const AsteroidShape& s = getShape();
+        Vector2 c = center();
+        float dx = c.x - Clamp(c.x, 0, config.fieldWidth);
+        float dy = c.y - Clamp(c.y, 0, config.fieldHeight);
+        if (dx * dx + dy * dy > s.radius * s.radius) {
+            return false;
+        }
+
+        for (Vector2 vertex : s.vertices) {
+            Vector2 p = toField(vertex);
+            if (0 <= p.x && p.x <= config.fieldWidth && 0 <= p.y && p.y <= config.fieldHeight) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// Asteroids stored as one array per field. Rows are read and written as
+// Asteroid values, the per tick passes work on the arrays directly.
+struct Asteroids {
+    AlignedVector<float> x;
+    AlignedVector<float> y;
+    AlignedVector<float> dirX;
+    AlignedVector<float> dirY;
+    AlignedVector<float> angle;
+    AlignedVector<float> angularVelocity;
+    AlignedVector<float> cosAngle;
+    AlignedVector<float> sinAngle;
+    AlignedVector<uint32_t> shape;
+    // Pose before the last tick, for render interpolation
+    AlignedVector<float> prevX;
+    AlignedVector<float> prevY;
+    AlignedVector<float> prevAngle;
+    // Kill marks, cleared by removeDead()
+    AlignedVector<uint8_t> dead;
+
+    size_t size() const {
+        return x.size();
+    }
+
+    bool empty() const {
+        return x.empty();
+    }
+
+    Asteroid get(size_t i) const;
+
+    // Asteroid between the previous and the current tick, for drawing
+    Asteroid interpolated(size_t i, float alpha) const;
+
+    void reserve(size_t n);
+    void push_back(const Asteroid& asteroid);
+
+    // Marking twice is harmless, the asteroid is removed once
+    void kill(size_t i) {
+        dead[i] = 1;
+    }
+
+    // Drops killed asteroids in one pass, keeping the order of the rest.
+    // Returns how many were removed
+    size_t removeDead();
+
+    // Advances the angles of [begin, end). The rotation matrices are left
+    // as they were, see refreshRotation()
+    void rotate(float scale, size_t begin, size_t end);
+
+    void rotate(float scale = 1) {
+        rotate(scale, 0, size());
+    }
+
+    // Brings the rotation matrix of i up to its angle
+    void refreshRotation(size_t i) {
+        cosAngle[i] = cosf(angle[i]);
+        sinAngle[i] = sinf(angle[i]);
+    }
+
+    // Advances the positions of [begin, end) by their direction
+    void move(float scale, size_t begin, size_t end);
+
+    void move(float scale = 1) {
+        move(scale, 0, size());
+    }
+};
+
+// Same contract as raylib's GetRandomValue: inclusive range [min, max]
+struct Random {
+    uint64_t state;
+
+    Random(uint64_t seed = 0) : state(seed) {}
+
+    uint64_t next() {
+        // splitmix64
+        uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    int value(int min, int max) {
+        if (min > max) {
+            int tmp = max;
+            max = min;
+            min = tmp;
+        }
+        uint64_t range = (uint64_t)((int64_t)max - min) + 1;
+        return (int)(min + (int64_t)(next() % range));
+    }
+
+    // In [min, max), from the top 24 bits
+    float uniform(float min, float max) {
+        return min + (max - min) * (float)((next() >> 40) / (double)(1 << 24));
+    }
+};
+
+// Bits of Input::bits(), recordings store one byte per tick
+enum InputBit : uint8_t {
+    INPUT_ROTATE_LEFT = 1 << 0,
+    INPUT_ROTATE_RIGHT = 1 << 1,
+    INPUT_FORWARD = 1 << 2,
+    INPUT_BACKWARD = 1 << 3,
+    INPUT_FIRE = 1 << 4,
+    INPUT_DEBUG = 1 << 5,
+};
+
+// Player controls for one simulation tick
+struct Input {
+    bool rotateLeft = false;
+    bool rotateRight = false;
+    bool forward = false;
+    bool backward = false;
+    bool fire = false;
+    // Debug HUD toggled, ignored by the simulation. Kept so a replay
+    // knows when it was on
+    bool debug = false;
+
+    uint8_t bits() const {
+        return (rotateLeft ? INPUT_ROTATE_LEFT : 0) |
+            (rotateRight ? INPUT_ROTATE_RIGHT : 0) |
+            (forward ? INPUT_FORWARD : 0) |
+            (backward ? INPUT_BACKWARD : 0) |
+            (fire ? INPUT_FIRE : 0) |
+            (debug ? INPUT_DEBUG : 0);
+    }
+
+    static Input fromBits(uint8_t bits) {
+        Input input;
+        input.rotateLeft = bits & INPUT_ROTATE_LEFT;
+        input.rotateRight = bits & INPUT_ROTATE_RIGHT;
+        input.forward = bits & INPUT_FORWARD;
+        input.backward = bits & INPUT_BACKWARD;
+        input.fire = bits & INPUT_FIRE;
+        input.debug = bits & INPUT_DEBUG;
+        return input;
+    }
+
+    // Pilot of headless runs and stress scenarios: keeps turning, pulses
+    // the engine and fires regularly
+    static Input scripted(uint64_t tick) {
+        Input input;
+        input.rotateRight = true;
+        input.forward = (tick / 60) % 2 == 0;
+        input.fire = tick % 8 == 0;
+        return input;
+    }
+};
+
+bool CheckAsteroidCollision(Vector2 p, std::vector<Vector2>& points);
+
+bool CheckAsteroidCollision(Vector2 p, const Vector2* points, size_t count);
+
+void addShot(Shots& shots, Ship& ship);
+
+void moveShots(Shots& shots, float scale = 1);
+
+Asteroid getRandAsteroid(Random& random);
+
+struct Hit {
+    uint32_t asteroid;
+    uint32_t shot;
+};
+
+// Buffers of one worker in the asteroid pass, kept to reuse their capacity
+struct CollisionScratch {
+    std::vector<Vector2> points;
+    std::vector<uint32_t> shots;
+    std::vector<uint8_t> inside;
+    std::vector<Hit> hits;
+    // Asteroids that got the full update this tick
+    size_t detailed = 0;
+    // Time this worker spent moving and colliding asteroids, only
+    // measured when phases are timed
+    float updateMs = 0;
+    float collisionMs = 0;
+};
+
+// Asteroids per job in the parallel asteroid pass
+const size_t ASTEROID_CHUNK = 1024;
+
+struct World {
+    Ship ship;
+    Shots shots;
+    Asteroids asteroids;
+    uint64_t score = 0;
+    uint64_t tick = 0;
+    Random random;
+
+    // Simulation ticks per second and the matching per-tick scale
+    float tickRate = BASE_TICK_RATE;
+    float tickScale = 1;
+
+    // Test every shot against every asteroid with the scalar
+    // CheckAsteroidCollision instead of the grid and the batch test
+    bool bruteForceCollisions = false;
+
+    SpatialGrid grid;
+
+    // Level of detail: asteroids outside the marked chunks only move and
+    // advance their angle. Nothing can hit them there, so the result is the
+    // same as updating everything
+    ChunkMap chunks;
+    // Half the visible area around the ship, kept in full detail so the
+    // drawn asteroids are current. The game sets it from the window size
+    Vector2 viewHalfSize = { 800, 450 };
+    // Asteroids that got the full update in the last tick
+    size_t detailedAsteroids = 0;
+
+    // Backs the transient buffers of step(), reset at the end of each tick
+    FrameArena arena;
+
+    // Runs the asteroid pass in parallel chunks when set, owned elsewhere
+    JobSystem* jobs = nullptr;
+    std::vector<CollisionScratch> scratch;
+
+    // Phases of step() are added here when set and enabled, owned elsewhere
+    FrameTimings* timings = nullptr;
+
+    World(uint64_t seed = 0, float tickRate = BASE_TICK_RATE);
+
+    // Advance the game by one tick
+    void step(const Input& input);
+
+    // FNV-1a over everything a tick reads, equal for equal games
+    uint64_t hash() const;
+
+    // Despawns and collides the asteroids of [begin, end) that are in
+    // detailed chunks or whose position left the field. Safe to run
+    // on disjoint ranges at once: only kill marks of its own asteroids are
+    // written, shot hits go to scratch
+    void collideRange(size_t begin, size_t end, const std::array<Vector2, 3>& shipVertices,
+        const Vector2* shotPositions, CollisionScratch& scratch);
+};
@@ -0,0 +1,78 @@
+#include "spatial_grid.h"
+
+#include <algorithm>
+
+// Smallest table, and the most it may be filled
+const size_t MIN_GRID_SLOTS = 64;
+const size_t GRID_LOAD_FACTOR = 2;
+
+static void resizeSlots(SpatialGrid& grid, size_t maxItems) {
+    size_t slots = MIN_GRID_SLOTS;
+    int bits = 6;
+    while (slots < maxItems * GRID_LOAD_FACTOR) {
+        slots *= 2;
+        bits++;
+    }
+
+    grid.slotKey.assign(slots, 0);
+    grid.slotStart.assign(slots, 0);
+    grid.slotCount.assign(slots, 0);
+    grid.slotCursor.assign(slots, 0);
+    grid.slotMask = slots - 1;
+    grid.slotShift = 64 - bits;
+    grid.usedSlots.clear();
+    grid.usedSlots.reserve(std::max(maxItems, MIN_GRID_SLOTS));
+}
+
+void SpatialGrid::reset(float size, size_t maxItems) {
+    cellSize = size;
+    resizeSlots(*this, maxItems);
+    items.clear();
+    items.reserve(maxItems);
+    itemSlot.reserve(maxItems);
+}
+
+void SpatialGrid::build(const Vector2* centers, const uint32_t* ids, size_t n) {
+    // Only the cells of the last build are cleared
+    if (n * GRID_LOAD_FACTOR > slotKey.size()) {
+        resizeSlots(*this, n);
+    }
+    else {
+        for (uint32_t s : usedSlots) {
+            slotCount[s] = 0;
+        }
+        usedSlots.clear();
+    }
+
+    // Count items per cell
+    itemSlot.resize(n);
+
+    for (size_t i = 0; i < n; i++) {
+        uint64_t k = key(cellOf(centers[i].x), cellOf(centers[i].y));
+        uint64_t s = home(k);
+        while (slotCount[s] != 0 && slotKey[s] != k) {
+            s = (s + 1) & slotMask;
+        }
+        if (slotCount[s] == 0) {
+            slotKey[s] = k;
+            usedSlots.push_back((uint32_t)s);
+        }
+        slotCount[s]++;
+        itemSlot[i] = (uint32_t)s;
+    }
+
+    // Prefix sum over the used cells
+    uint32_t start = 0;
+    for (uint32_t s : usedSlots) {
+        slotStart[s] = start;
+        slotCursor[s] = start;
+        start += slotCount[s];
+    }
+
+    // Scatter, keeping input order inside a cell
+    items.resize(n);
+
+    for (size_t i = 0; i < n; i++) {
+        items[slotCursor[itemSlot[i]]++] = ids[i];
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+// Uniform grid used as a broad-phase for shot/asteroid collisions. Only
+// cells holding items exist: they live in a hash table sized from the
+// item count, not the field, so a rebuild costs the same on any map size.
+// Items are bucketed by cell with a counting sort over the used cells, and
+// the grid keeps its buffers between ticks.
+
+#include "include/raymath.h"
+#include <math.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+struct SpatialGrid {
+    float cellSize = 1;
+
+    // Open addressing table of cells, a power of two in size. A slot is
+    // empty when its count is 0
+    std::vector<uint64_t> slotKey;
+    std::vector<uint32_t> slotStart;
+    std::vector<uint32_t> slotCount;
+    uint64_t slotMask = 0;
+    int slotShift = 64;
+    // Slots filled by the last build, in the order they were first used
+    std::vector<uint32_t> usedSlots;
+
+    // Items of a slot are items[slotStart .. slotStart + slotCount)
+    std::vector<uint32_t> items;
+    std::vector<uint32_t> itemSlot;
+    std::vector<uint32_t> slotCursor;
+
+    // cellSize must be at least the largest item radius for query() to find
+    // every item whose bounding circle contains the point. The table is
+    // sized for maxItems, so builds up to that many don't allocate
+    void reset(float cellSize, size_t maxItems = 0);
+
+    int cellOf(float v) const {
+        // Clamped so far off coordinates stay in int range
+        float c = floorf(v / cellSize);
+        return c < -1e9f ? -1000000000 : (c > 1e9f ? 1000000000 : (int)c);
+    }
+
+    static uint64_t key(int cx, int cy) {
+        return ((uint64_t)(uint32_t)cx << 32) | (uint32_t)cy;
+    }
+
+    // First slot probed for a cell
+    uint64_t home(uint64_t k) const {
+        return (k * 0x9E3779B97F4A7C15ull) >> slotShift;
+    }
+
+    // Slot of the cell, or -1 if no item is in it
+    int64_t find(uint64_t k) const {
+        uint64_t s = home(k);
+        while (slotCount[s] != 0) {
+            if (slotKey[s] == k) {
+                return (int64_t)s;
+            }
+            s = (s + 1) & slotMask;
+        }
+        return -1;
+    }
+
+    // ids[k] is stored at centers[k]
+    void build(const Vector2* centers, const uint32_t* ids, size_t n);
+
+    // Calls f(id) for every item in the cell of p and its eight neighbours
+    template <typename F>
+    void query(Vector2 p, F&& f) const {
+        if (items.empty()) {
+            return;
+        }
+
+        int cx = cellOf(p.x);
+        int cy = cellOf(p.y);
+
+        for (int y = cy - 1; y <= cy + 1; y++) {
+            for (int x = cx - 1; x <= cx + 1; x++) {
+                int64_t s = find(key(x, y));
+                if (s < 0) {
+                    continue;
+                }
+                for (uint32_t k = slotStart[s], end = k + slotCount[s]; k < end; k++) {
+                    f(items[k]);
+                }
+            }
+        }
+    }
+};
@@ -0,0 +1,449 @@
+// Named stress scenarios of the simulation, checked against a baseline.
+//
+// Usage: ./stress [options] [scenario...]
+//
+//   --list              print the scenarios and exit
+//   --threads n         worker threads for the asteroid pass
+//   --runs n            run each scenario n times and keep the best, 3 by
+//                       default, to ride out noise from the rest of the machine
+//   --save-baseline f   write the results as a baseline
+//   --baseline f        compare against a baseline and exit with 1 if a
+//                       scenario regressed
+//   --threshold pct     allowed loss of ticks/s or growth of the p99 tick
+//                       time before it counts as a regression, 10 by default
+//
+// Without scenario names every scenario runs. Each one sets up the field,
+// the asteroids and shots, and a scripted pilot, then times a fixed number
+// of ticks after a tenth of them as warm-up. Runs are deterministic, the
+// hash of the final world is compared too: a changed hash means the
+// simulation itself changed and the times are not comparable.
+//
+// Baselines are JSON, one scenario per line, as --save-baseline writes
+// them:
+//
+//     {
+//       "threads": 0,
+//       "simd": "avx2",
+//       "compiler": "12.2.0",
+//       "scenarios": [
+//         {"name": "dense-cluster", "ticks": 3000, "ticks_per_second": 41234.5, "p50_us": 23.1, "p99_us": 31.7, "hash": "..."}
+//       ]
+//     }
+//
+// The times only compare between runs with the same settings, so a
+// baseline from another thread count, SIMD level or compiler is refused.
+
+#include <chrono>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "simulation.h"
+#include "histogram.h"
+#include "point_in_polygon.h"
+
+struct Scenario {
+    const char* name;
+    const char* description;
+    int fieldWidth;
+    int fieldHeight;
+    size_t maxAsteroids;
+    size_t maxShots;
+    uint64_t ticks;
+    // Fills the new world before the first tick
+    void (*populate)(World& world, Random& random);
+    Input (*input)(uint64_t tick);
+};
+
+// Asteroids at random spots within radius of the ship, moving at up to
+// speed in any direction
+void scatterAsteroids(World& world, Random& random, float radius, float speed) {
+    while (world.asteroids.size() < config.maxAsteroids) {
+        float angle = random.uniform(-PI, PI);
+        float distance = radius * sqrtf(random.uniform(0, 1));
+        Vector2 pos = Vector2Add(world.ship.pos, Vector2{ distance * cosf(angle), distance * sinf(angle) });
+
+        float heading = random.uniform(-PI, PI);
+        float v = random.uniform(0.1f * speed, speed);
+        Vector2 dir = { v * cosf(heading), v * sinf(heading) };
+
+        world.asteroids.push_back(Asteroid(pos, dir, random.value(0, asteroidsLibarary.size() - 1)));
+    }
+}
+
+// Asteroids spread uniformly over the whole field
+void spreadAsteroids(World& world, Random& random, float speed) {
+    while (world.asteroids.size() < config.maxAsteroids) {
+        Vector2 pos = { random.uniform(0, config.fieldWidth), random.uniform(0, config.fieldHeight) };
+
+        float heading = random.uniform(-PI, PI);
+        float v = random.uniform(0.1f * speed, speed);
+        Vector2 dir = { v * cosf(heading), v * sinf(heading) };
+
+        world.asteroids.push_back(Asteroid(pos, dir, random.value(0, asteroidsLibarary.size() - 1)));
+    }
+}
+
+void populateCluster(World& world, Random& random) {
+    scatterAsteroids(world, random, 2000, 3);
+}
+
+void populateSparse(World& world, Random& random) {
+    spreadAsteroids(world, random, 3);
+}
+
+// Asteroids around the ship and the shot limit already in the air, fanned
+// out from the ship
+void populateStorm(World& world, Random& random) {
+    scatterAsteroids(world, random, 5000, 3);
+
+    while (world.shots.size() < config.maxShots) {
+        float angle = random.uniform(-PI, PI);
+        float distance = random.uniform(0, 5000);
+        Vector2 dir = { cosf(angle), sinf(angle) };
+        world.shots.push_back(Shot{ Vector2Add(world.ship.pos, Vector2Scale(dir, distance)), dir });
+    }
+}
+
+void populateSlowMillion(World& world, Random& random) {
+    spreadAsteroids(world, random, 0.3f);
+}
+
+// Flies straight on, across chunks
+Input cruisingInput(uint64_t tick) {
+    Input input;
+    input.forward = true;
+    input.fire = tick % 16 == 0;
+    return input;
+}
+
+// Turns in place and fires every tick, keeping the shots at the limit
+Input stormInput(uint64_t) {
+    Input input;
+    input.rotateRight = true;
+    input.fire = true;
+    return input;
+}
+
+const Scenario SCENARIOS[] = {
+    {
+        "dense-cluster", "5,000 asteroids within 2,000 of the ship on a 20,000 field",
+        20000, 20000, 5000, 100, 3000, populateCluster, Input::scripted,
+    },
+    {
+        "sparse-giant-map", "50,000 asteroids over a 1,000,000 x 1,000,000 field",
+        1000000, 1000000, 50000, 100, 1000, populateSparse, cruisingInput,
+    },
+    {
+        "shot-storm", "10,000 shots, a shot every tick, among 5,000 asteroids",
+        100000, 100000, 5000, 10000, 1000, populateStorm, stormInput,
+    },
+    {
+        "million-slow", "1,000,000 slow asteroids over a 1,000,000 x 1,000,000 field",
+        1000000, 1000000, 1000000, 100, 100, populateSlowMillion, Input::scripted,
+    },
+};
+
+struct Result {
+    char name[64] = {};
+    uint64_t ticks = 0;
+    double ticksPerSecond = 0;
+    double p50 = 0;
+    double p99 = 0;
+    uint64_t hash = 0;
+};
+
+// What the times of a run depend on besides the code
+struct Settings {
+    unsigned threads = 0;
+    char simd[16] = {};
+    char compiler[128] = {};
+};
+
+Settings currentSettings(unsigned threads) {
+    Settings settings;
+    settings.threads = threads;
+    snprintf(settings.simd, sizeof(settings.simd), "%s", simdLevelName(bestSimdLevel()));
+    snprintf(settings.compiler, sizeof(settings.compiler), "%s", __VERSION__);
+    return settings;
+}
+
+Result runScenario(const Scenario& scenario, JobSystem* jobs) {
+    Config saved = config;
+    config.fieldWidth = scenario.fieldWidth;
+    config.fieldHeight = scenario.fieldHeight;
+    config.maxAsteroids = scenario.maxAsteroids;
+    config.maxShots = scenario.maxShots;
+
+    Result result;
+    snprintf(result.name, sizeof(result.name), "%s", scenario.name);
+    result.ticks = scenario.ticks;
+
+    {
+        World world(1);
+        world.jobs = jobs;
+
+        Random random(2);
+        scenario.populate(world, random);
+
+        Histogram tickTimes("tick");
+        uint64_t warmup = scenario.ticks / 10;
+
+        auto warm = std::chrono::steady_clock::now();
+        auto tickStart = warm;
+
+        for (uint64_t i = 0; i < scenario.ticks; i++) {
+            world.step(scenario.input(world.tick));
+
+            auto tickEnd = std::chrono::steady_clock::now();
+            if (i >= warmup) {
+                tickTimes.record(std::chrono::duration_cast<std::chrono::nanoseconds>(tickEnd - tickStart).count());
+            }
+            else {
+                warm = tickEnd;
+            }
+            tickStart = tickEnd;
+        }
+
+        double seconds = std::chrono::duration<double>(tickStart - warm).count();
+        result.ticksPerSecond = seconds > 0 ? (scenario.ticks - warmup) / seconds : 0;
+        result.p50 = tickTimes.percentile(50) / 1e3;
+        result.p99 = tickTimes.percentile(99) / 1e3;
+        result.hash = world.hash();
+    }
+
+    config = saved;
+    return result;
+}
+
+bool saveBaseline(const char* path, const std::vector<Result>& results, const Settings& settings) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Can't write baseline %s\n", path);
+        return false;
+    }
+
+    fprintf(file, "{\n  \"threads\": %u,\n  \"simd\": \"%s\",\n  \"compiler\": \"%s\",\n  \"scenarios\": [\n",
+        settings.threads, settings.simd, settings.compiler);
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        fprintf(file, "    {\"name\": \"%s\", \"ticks\": %llu, \"ticks_per_second\": %.3f, \"p50_us\": %.3f, \"p99_us\": %.3f, \"hash\": \"%016llx\"}%s\n",
+            r.name, (unsigned long long)r.ticks, r.ticksPerSecond, r.p50, r.p99, (unsigned long long)r.hash,
+            i + 1 < results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+
+    bool ok = !ferror(file);
+    ok = fclose(file) == 0 && ok;
+    if (!ok) {
+        fprintf(stderr, "Failed writing baseline %s\n", path);
+    }
+
+    return ok;
+}
+
+// Reads the settings and scenario lines of a file written by saveBaseline.
+// Settings missing from the file are left empty
+bool loadBaseline(const char* path, Settings& settings, std::vector<Result>& results) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Can't open baseline %s\n", path);
+        return false;
+    }
+
+    char line[512];
+    while (fgets(line, sizeof(line), file)) {
+        sscanf(line, " \"threads\": %u", &settings.threads);
+        sscanf(line, " \"simd\": \"%15[^\"]\"", settings.simd);
+        sscanf(line, " \"compiler\": \"%127[^\"]\"", settings.compiler);
+
+        const char* object = strstr(line, "{\"name\"");
+        if (!object) {
+            continue;
+        }
+
+        Result r;
+        unsigned long long ticks;
+        unsigned long long hash;
+        int fields = sscanf(object,
+            "{\"name\": \"%63[^\"]\", \"ticks\": %llu, \"ticks_per_second\": %lf, \"p50_us\": %lf, \"p99_us\": %lf, \"hash\": \"%llx\"}",
+            r.name, &ticks, &r.ticksPerSecond, &r.p50, &r.p99, &hash);
+
+        if (fields != 6) {
+            fprintf(stderr, "%s: can't read %s", path, line);
+            fclose(file);
+            return false;
+        }
+
+        r.ticks = ticks;
+        r.hash = hash;
+        results.push_back(r);
+    }
+
+    fclose(file);
+    return true;
+}
+
+const Result* findResult(const std::vector<Result>& results, const char* name) {
+    for (const Result& r : results) {
+        if (strcmp(r.name, name) == 0) {
+            return &r;
+        }
+    }
+    return nullptr;
+}
+
+double percentChange(double value, double base) {
+    return base > 0 ? 100 * (value - base) / base : 0;
+}
+
+int main(int argc, char** argv) {
+    unsigned threads = 0;
+    int runs = 3;
+    const char* savePath = NULL;
+    const char* baselinePath = NULL;
+    double threshold = 10;
+    std::vector<const Scenario*> selected;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--list") == 0) {
+            for (const Scenario& s : SCENARIOS) {
+                printf("%-18s %s, %llu ticks\n", s.name, s.description, (unsigned long long)s.ticks);
+            }
+            return 0;
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            if (!parseWorkerCount(argv[++i], threads)) {
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            runs = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--save-baseline") == 0 && i + 1 < argc) {
+            savePath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baselinePath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = atof(argv[++i]);
+        }
+        else if (strncmp(argv[i], "--", 2) == 0) {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+        else {
+            const Scenario* found = nullptr;
+            for (const Scenario& s : SCENARIOS) {
+                if (strcmp(s.name, argv[i]) == 0) {
+                    found = &s;
+                }
+            }
+            if (!found) {
+                fprintf(stderr, "Unknown scenario %s, see --list\n", argv[i]);
+                return 1;
+            }
+            selected.push_back(found);
+        }
+    }
+
+    if (selected.empty()) {
+        for (const Scenario& s : SCENARIOS) {
+            selected.push_back(&s);
+        }
+    }
+    if (runs < 1) {
+        runs = 1;
+    }
+
+    Settings settings = currentSettings(threads);
+
+    std::vector<Result> baseline;
+    if (baselinePath) {
+        Settings base;
+        if (!loadBaseline(baselinePath, base, baseline)) {
+            return 1;
+        }
+
+        if (base.threads != settings.threads) {
+            fprintf(stderr, "Baseline %s ran with --threads %u, this run with %u. Match it or save a new baseline\n",
+                baselinePath, base.threads, settings.threads);
+            return 1;
+        }
+        if (base.simd[0] && strcmp(base.simd, settings.simd) != 0) {
+            fprintf(stderr, "Baseline %s ran with %s point-in-polygon, this run with %s\n",
+                baselinePath, base.simd, settings.simd);
+            return 1;
+        }
+        if (base.compiler[0] && strcmp(base.compiler, settings.compiler) != 0) {
+            fprintf(stderr, "Baseline %s was built with compiler %s, this run with %s\n",
+                baselinePath, base.compiler, settings.compiler);
+            return 1;
+        }
+    }
+
+    JobSystem jobs(threads);
+
+    std::vector<Result> results;
+    bool regressed = false;
+
+    for (const Scenario* scenario : selected) {
+        // Best of the runs, each measure on its own
+        Result best;
+        for (int run = 0; run < runs; run++) {
+            Result r = runScenario(*scenario, threads > 0 ? &jobs : nullptr);
+            if (run == 0) {
+                best = r;
+                continue;
+            }
+            if (r.ticksPerSecond > best.ticksPerSecond) {
+                best.ticksPerSecond = r.ticksPerSecond;
+            }
+            if (r.p99 < best.p99) {
+                best.p99 = r.p99;
+                best.p50 = r.p50;
+            }
+        }
+        results.push_back(best);
+
+        printf("%-18s ticks/s %10.1f  p50 %9.1f us  p99 %9.1f us  hash %016llx",
+            best.name, best.ticksPerSecond, best.p50, best.p99, (unsigned long long)best.hash);
+
+        const Result* base = findResult(baseline, best.name);
+        if (base && base->ticks == best.ticks) {
+            double throughput = percentChange(best.ticksPerSecond, base->ticksPerSecond);
+            double p99 = percentChange(best.p99, base->p99);
+            bool worse = throughput < -threshold || p99 > threshold;
+
+            printf("  vs baseline ticks/s %+.1f%% p99 %+.1f%%%s", throughput, p99, worse ? "  REGRESSION" : "");
+            if (base->hash != best.hash) {
+                printf("  (hash differs, the simulation changed)");
+            }
+            regressed = regressed || worse;
+        }
+        else if (base) {
+            printf("  baseline ran %llu ticks, not compared", (unsigned long long)base->ticks);
+        }
+        else if (baselinePath) {
+            printf("  not in baseline");
+        }
+
+        printf("\n");
+        fflush(stdout);
+    }
+
+    if (savePath && !saveBaseline(savePath, results, settings)) {
+        return 1;
+    }
+
+    if (regressed) {
+        fprintf(stderr, "Regressions beyond %g%%\n", threshold);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,174 @@
+#include "trace.h"
+
+#include <stdio.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<int> tracing{ TRACE_OFF };
+
+struct TraceRecord {
+    const char* name;
+    // Nanoseconds of TraceClock
+    int64_t begin;
+    int64_t end;
+};
+
+struct TraceBuffer {
+    uint32_t tid;
+    bool mainThread = false;
+    // Taken by a thread, spare buffers aren't written out
+    bool claimed = false;
+    std::unique_ptr<TraceRecord[]> records;
+    size_t capacity;
+    // Events ever recorded, the last capacity of them are kept
+    uint64_t count = 0;
+};
+
+static std::mutex registryLock;
+static std::vector<std::unique_ptr<TraceBuffer>> buffers;
+// Allocated by startTracing() and not taken by a thread yet
+static std::vector<TraceBuffer*> spareBuffers;
+static size_t bufferCapacity = DEFAULT_TRACE_EVENTS;
+static TraceClock::time_point epoch;
+
+static thread_local TraceBuffer* localBuffer = nullptr;
+
+// Called with registryLock held
+static TraceBuffer* addBuffer() {
+    auto buffer = std::make_unique<TraceBuffer>();
+    buffer->tid = (uint32_t)buffers.size();
+    // Zeroed, so its pages are touched here and not by the first events
+    buffer->records = std::make_unique<TraceRecord[]>(bufferCapacity);
+    buffer->capacity = bufferCapacity;
+
+    buffers.push_back(std::move(buffer));
+    return buffers.back().get();
+}
+
+void startTracing(TraceDetail detail, unsigned threads, size_t eventsPerThread) {
+    std::lock_guard<std::mutex> guard(registryLock);
+    // A power of two, so the ring is indexed with a mask
+    bufferCapacity = 1;
+    while (bufferCapacity < eventsPerThread) {
+        bufferCapacity *= 2;
+    }
+    epoch = TraceClock::now();
+
+    if (!localBuffer) {
+        localBuffer = addBuffer();
+        localBuffer->claimed = true;
+    }
+    localBuffer->mainThread = true;
+
+    while (spareBuffers.size() < threads) {
+        spareBuffers.push_back(addBuffer());
+    }
+
+    tracing.store(detail, std::memory_order_relaxed);
+}
+
+void stopTracing() {
+    tracing.store(TRACE_OFF, std::memory_order_relaxed);
+}
+
+static TraceBuffer* registerThread() {
+    std::lock_guard<std::mutex> guard(registryLock);
+
+    TraceBuffer* buffer;
+    if (!spareBuffers.empty()) {
+        buffer = spareBuffers.back();
+        spareBuffers.pop_back();
+    }
+    else {
+        buffer = addBuffer();
+    }
+
+    buffer->claimed = true;
+    return buffer;
+}
+
+void traceEvent(const char* name, TraceClock::time_point begin, TraceClock::time_point end) {
+    if (!localBuffer) {
+        localBuffer = registerThread();
+    }
+
+    TraceBuffer& buffer = *localBuffer;
+    buffer.records[buffer.count & (buffer.capacity - 1)] = TraceRecord{
+        name,
+        std::chrono::duration_cast<std::chrono::nanoseconds>(begin.time_since_epoch()).count(),
+        std::chrono::duration_cast<std::chrono::nanoseconds>(end.time_since_epoch()).count(),
+    };
+    buffer.count++;
+}
+
+uint64_t traceEventCount() {
+    std::lock_guard<std::mutex> guard(registryLock);
+    uint64_t count = 0;
+    for (auto& buffer : buffers) {
+        count += buffer->count;
+    }
+    return count;
+}
+
+uint64_t traceEventsDropped() {
+    std::lock_guard<std::mutex> guard(registryLock);
+    uint64_t dropped = 0;
+    for (auto& buffer : buffers) {
+        if (buffer->count > buffer->capacity) {
+            dropped += buffer->count - buffer->capacity;
+        }
+    }
+    return dropped;
+}
+
+bool writeTrace(const char* path) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Can't write trace %s\n", path);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> guard(registryLock);
+
+    int64_t start = std::chrono::duration_cast<std::chrono::nanoseconds>(epoch.time_since_epoch()).count();
+
+    // Complete ("X") events, a begin and an end in one. Times are in
+    // microseconds since startTracing()
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    bool first = true;
+    for (auto& buffer : buffers) {
+        if (!buffer->claimed) {
+            continue;
+        }
+
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"",
+            first ? "" : ",\n", buffer->tid);
+        if (buffer->mainThread) {
+            fprintf(file, "main");
+        }
+        else {
+            fprintf(file, "thread %u", buffer->tid);
+        }
+        fprintf(file, "\"}}");
+        first = false;
+
+        uint64_t kept = buffer->count < buffer->capacity ? buffer->count : buffer->capacity;
+        for (uint64_t i = buffer->count - kept; i < buffer->count; i++) {
+            const TraceRecord& r = buffer->records[i & (buffer->capacity - 1)];
+            fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                r.name, buffer->tid, (r.begin - start) / 1000.0, (r.end - r.begin) / 1000.0);
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+
+    bool ok = !ferror(file);
+    ok = fclose(file) == 0 && ok;
+    if (!ok) {
+        fprintf(stderr, "Failed writing trace %s\n", path);
+    }
+
+    return ok;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+// Opt-in tracing of where the time of a tick or frame goes, written as a
+// Chrome trace-event JSON file that Perfetto (ui.perfetto.dev) and
+// chrome://tracing open.
+//
+// Every thread records into its own ring buffer, so recording takes no
+// lock. The buffers are allocated by startTracing(), for the calling thread
+// and as many others as it is told, and a thread takes one at its first
+// event. Buffers keep the last events when they wrap. writeTrace() must be
+// called while no thread is recording, at exit.
+//
+//     startTracing(TRACE_PHASES);
+//     {
+//         TraceScope scope("frame");
+//         ...
+//     }
+//     writeTrace("trace.json");
+//
+// An event costs two clock reads, tens of nanoseconds. That is nothing
+// next to a frame, but a lot against a tick of the small default map that
+// takes a few microseconds. So TRACE_TICKS keeps only the spans the caller
+// times anyway (ticks and frames), and the phase and chunk spans inside a
+// tick take TRACE_PHASES.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <chrono>
+
+using TraceClock = std::chrono::steady_clock;
+
+enum TraceDetail {
+    TRACE_OFF,
+    // Ticks and frames only
+    TRACE_TICKS,
+    // And the phases of each, and the asteroid chunks of each thread
+    TRACE_PHASES,
+};
+
+extern std::atomic<int> tracing;
+
+inline bool tracingEnabled() {
+    return tracing.load(std::memory_order_relaxed) != TRACE_OFF;
+}
+
+inline bool tracingPhases() {
+    return tracing.load(std::memory_order_relaxed) == TRACE_PHASES;
+}
+
+// Events kept per thread before the oldest are overwritten, 24 bytes each.
+// Rounded up to a power of two
+const size_t DEFAULT_TRACE_EVENTS = 1 << 20;
+
+// threads is the number of other threads that will record, worker threads
+// included. Past that a thread allocates its buffer at its first event
+void startTracing(TraceDetail detail, unsigned threads = 0, size_t eventsPerThread = DEFAULT_TRACE_EVENTS);
+void stopTracing();
+
+// Records name from begin to end on the calling thread. name must outlive
+// the trace, string literals are
+void traceEvent(const char* name, TraceClock::time_point begin, TraceClock::time_point end);
+
+// Events of every thread, oldest first per thread. Returns false with a
+// message on stderr if the file can't be written
+bool writeTrace(const char* path);
+
+// Events recorded and overwritten by wrapping, over all threads
+uint64_t traceEventCount();
+uint64_t traceEventsDropped();
+
+struct TraceScope {
+    const char* name;
+    bool traced;
+    TraceClock::time_point start;
+
+    explicit TraceScope(const char* name) : name(name), traced(tracingEnabled()) {
+        if (traced) {
+            start = TraceClock::now();
+        }
+    }
+
+    ~TraceScope() {
+        if (traced) {
+            traceEvent(name, start, TraceClock::now());
+        }
+    }
+};
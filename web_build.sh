@@ -1,3 +1,3 @@
-emcc -o docs/index.html main.cpp -Os -std=c++23 -Wall \
+emcc -o docs/index.html main.cpp simulation.cpp spatial_grid.cpp point_in_polygon.cpp frame_arena.cpp job_system.cpp config.cpp chunk_map.cpp recording.cpp phase_timer.cpp trace.cpp histogram.cpp perf_counters.cpp alloc_counter.cpp shape_renderer.cpp net_renderer.cpp hud_text.cpp -Os -std=c++23 -Wall \
     ./ray_wasm/libraylib.a -I. -I./include -lm -s USE_GLFW=3 -s ASYNCIFY --preload-file resources \
     --shell-file ./ray_wasm/minshell.html -DPLATFORM_WEB